@@ -0,0 +1,44 @@
+#include "Benchmark.h"
+
+#include "tp_maps_emcc/AssetCache.h"
+
+#include <vector>
+#include <cstdint>
+
+using namespace tp_maps_emcc;
+
+namespace tp_maps_emcc_benchmarks
+{
+
+//##################################################################################################
+void assetCacheBenchmarks()
+{
+  std::vector<uint8_t> data(1024*1024);
+  for(size_t i=0; i<data.size(); i++)
+    data[i] = uint8_t(i*31);
+
+  run("AssetCache keyForData 1MB", [&]
+  {
+    AssetCache::Key key = AssetCache::keyForData(data.data(), data.size());
+    data[0] = uint8_t(key.hash);
+    return size_t(1);
+  });
+
+  AssetCache cache;
+  std::vector<AssetCache::Key> keys;
+  for(uint32_t i=0; i<256; i++)
+  {
+    keys.push_back(AssetCache::keyForData(&i, sizeof(i)));
+    cache.insert<uint32_t>(keys.back(), std::make_shared<const uint32_t>(i), 1);
+  }
+
+  run("AssetCache find", [&]
+  {
+    size_t found=0;
+    for(const AssetCache::Key& key : keys)
+      found += cache.find<uint32_t>(key)?1:0;
+    return found;
+  });
+}
+
+}
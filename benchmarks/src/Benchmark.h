@@ -0,0 +1,33 @@
+#ifndef tp_maps_emcc_benchmarks_Benchmark_h
+#define tp_maps_emcc_benchmarks_Benchmark_h
+
+#include <functional>
+#include <string>
+#include <cstddef>
+
+namespace tp_maps_emcc_benchmarks
+{
+
+//##################################################################################################
+//! Allocations made through operator new since the program started.
+size_t allocations();
+
+//##################################################################################################
+//! Run body until at least minSeconds have passed and print the rate and allocations per item.
+/*!
+body is called repeatedly and returns the number of items, such as events, that it processed.
+*/
+void run(const std::string& name, const std::function<size_t()>& body, double minSeconds=0.5);
+
+//##################################################################################################
+void inputTranslatorBenchmarks();
+
+//##################################################################################################
+void assetCacheBenchmarks();
+
+//##################################################################################################
+void capturedFrameBenchmarks();
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "Benchmark.h"
+
+#include "tp_maps_emcc/FrameCapture.h"
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+using namespace tp_maps_emcc;
+
+namespace tp_maps_emcc_benchmarks
+{
+
+namespace
+{
+//##################################################################################################
+//! What a consumer of CapturedFrame does before encoding: flip to top row first and drop alpha.
+void toTopDownRGB(const CapturedFrame& frame, std::vector<uint8_t>& rgb)
+{
+  size_t w = size_t(frame.width);
+  size_t h = size_t(frame.height);
+  rgb.resize(w*h*3);
+
+  for(size_t y=0; y<h; y++)
+  {
+    const uint8_t* src = frame.pixels.data() + (h-1-y)*w*4;
+    uint8_t* dst = rgb.data() + y*w*3;
+    for(size_t x=0; x<w; x++)
+    {
+      dst[x*3+0] = src[x*4+0];
+      dst[x*3+1] = src[x*4+1];
+      dst[x*3+2] = src[x*4+2];
+    }
+  }
+}
+}
+
+//##################################################################################################
+void capturedFrameBenchmarks()
+{
+  CapturedFrame frame;
+  frame.width  = 1920;
+  frame.height = 1080;
+  frame.pixels.resize(size_t(frame.width)*size_t(frame.height)*4);
+  for(size_t i=0; i<frame.pixels.size(); i++)
+    frame.pixels[i] = uint8_t(i*31);
+
+  std::vector<uint8_t> flipped(frame.pixels.size());
+  run("CapturedFrame flip rows 1080p", [&]
+  {
+    size_t rowBytes = size_t(frame.width)*4;
+    size_t h = size_t(frame.height);
+    for(size_t y=0; y<h; y++)
+      std::memcpy(flipped.data() + y*rowBytes, frame.pixels.data() + (h-1-y)*rowBytes, rowBytes);
+    frame.pixels[0] = flipped[1];
+    return size_t(1);
+  });
+
+  std::vector<uint8_t> rgb;
+  run("CapturedFrame to top down RGB 1080p", [&]
+  {
+    toTopDownRGB(frame, rgb);
+    frame.pixels[0] = rgb[1];
+    return size_t(1);
+  });
+}
+
+}
@@ -0,0 +1,80 @@
+#include "Benchmark.h"
+
+#include "tp_maps_emcc/InputTranslator.h"
+
+#include <iostream>
+
+using namespace tp_maps_emcc;
+
+namespace tp_maps_emcc_benchmarks
+{
+
+//##################################################################################################
+void inputTranslatorBenchmarks()
+{
+  size_t emitted=0;
+  InputTranslator translator([&](const tp_maps::MouseEvent&){emitted++;});
+  translator.setPixelScale(2.0f);
+
+  int64_t timeMS=100000;
+
+  run("InputTranslator mouse move", [&]
+  {
+    MouseInput input;
+    input.type = MouseInputType::Move;
+    for(int i=0; i<1000; i++)
+    {
+      input.targetX = double(i%640);
+      input.targetY = double(i%480);
+      translator.mouseInput(input);
+    }
+    return size_t(1000);
+  });
+
+  run("InputTranslator touch pan", [&]
+  {
+    TouchInput input;
+    input.numTouches = 1;
+
+    input.type = TouchInputType::Start;
+    input.timeMS = timeMS;
+    translator.touchInput(input);
+
+    input.type = TouchInputType::Move;
+    for(int i=0; i<998; i++)
+    {
+      input.touches[0].targetX = double(i);
+      input.timeMS = ++timeMS;
+      translator.touchInput(input);
+    }
+
+    input.type = TouchInputType::End;
+    input.timeMS = timeMS += 1000;
+    translator.touchInput(input);
+    return size_t(1000);
+  });
+
+  run("InputTranslator pinch", [&]
+  {
+    TouchInput input;
+    input.numTouches = 2;
+    input.touches[1].targetX = 100.0;
+
+    input.type = TouchInputType::Start;
+    input.timeMS = timeMS;
+    translator.touchInput(input);
+
+    input.type = TouchInputType::Move;
+    for(int i=0; i<999; i++)
+    {
+      input.touches[1].targetX = 100.0 + double(i%200);
+      input.timeMS = ++timeMS;
+      translator.touchInput(input);
+    }
+    return size_t(1000);
+  });
+
+  std::cout << "InputTranslator emitted " << emitted << " events" << std::endl;
+}
+
+}
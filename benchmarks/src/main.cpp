@@ -0,0 +1,87 @@
+#include "Benchmark.h"
+
+#include "tp_maps_emcc/BuildVariant.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace
+{
+std::atomic<size_t> allocationCount{0};
+}
+
+//##################################################################################################
+void* operator new(size_t size)
+{
+  allocationCount++;
+  if(void* p = std::malloc(size?size:1))
+    return p;
+  throw std::bad_alloc();
+}
+
+//##################################################################################################
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+//##################################################################################################
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace tp_maps_emcc_benchmarks
+{
+
+//##################################################################################################
+size_t allocations()
+{
+  return allocationCount;
+}
+
+//##################################################################################################
+void run(const std::string& name, const std::function<size_t()>& body, double minSeconds)
+{
+  using Clock = std::chrono::steady_clock;
+
+  // Warm up so that one off allocations are not counted.
+  body();
+
+  size_t items=0;
+  size_t allocationsBefore = allocations();
+  auto start = Clock::now();
+  double seconds=0.0;
+  do
+  {
+    items += body();
+    seconds = std::chrono::duration<double>(Clock::now()-start).count();
+  }
+  while(seconds<minSeconds);
+
+  double perItem = items?double(allocations()-allocationsBefore)/double(items):0.0;
+
+  std::cout << name
+            << ": " << size_t(double(items)/seconds) << " items/s"
+            << ", " << perItem << " allocations/item" << std::endl;
+}
+
+}
+
+//##################################################################################################
+//! Benchmarks for the parts of tp_maps_emcc that do not depend on the browser.
+/*!
+Build natively or with each variant's EMCC_CFLAGS and run the output with node to compare variants.
+*/
+int main()
+{
+  std::cout << "Build variant: " << tp_maps_emcc::buildVariantToString(tp_maps_emcc::buildVariant()) << std::endl;
+
+  tp_maps_emcc_benchmarks::inputTranslatorBenchmarks();
+  tp_maps_emcc_benchmarks::assetCacheBenchmarks();
+  tp_maps_emcc_benchmarks::capturedFrameBenchmarks();
+  return 0;
+}
@@ -0,0 +1,13 @@
+TARGET = tp_maps_emcc_benchmarks
+TEMPLATE = app
+
+SOURCES += ../src/InputTranslator.cpp
+SOURCES += ../src/AssetCache.cpp
+SOURCES += ../src/BuildVariant.cpp
+
+SOURCES += src/main.cpp
+HEADERS += src/Benchmark.h
+
+SOURCES += src/InputTranslatorBenchmark.cpp
+SOURCES += src/AssetCacheBenchmark.cpp
+SOURCES += src/CapturedFrameBenchmark.cpp
@@ -0,0 +1,138 @@
+#ifndef tp_maps_emcc_AssetCache_h
+#define tp_maps_emcc_AssetCache_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <memory>
+#include <functional>
+#include <typeinfo>
+#include <cstdint>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! Decoded CPU side assets shared by all the maps in a MapManager.
+/*!
+Assets are addressed by a hash of the data they were decoded from, so maps loading the same image
+or model decode it once and each upload to their own context from the shared copy. The key also
+holds the size of the source data so a hash collision also needs equal sizes to return the wrong
+asset. Keys built by hand must be unique to the asset, the cache can't detect a collision.
+
+The cache holds a reference to every asset, an asset is only evicted once the cache holds the last
+reference and then least recently used first. Assets that are still in use count towards the limit
+but are never evicted, so the limit can be exceeded while they are held.
+
+\code
+auto key = AssetCache::keyForData(encoded.data(), encoded.size());
+auto image = cache.fetch<Image>(key, [&](size_t& bytes)
+{
+  auto image = std::make_shared<Image>(decodeImage(encoded));
+  bytes = image->pixels.size()*sizeof(Pixel);
+  return image;
+});
+\endcode
+*/
+class TP_MAPS_EMCC_SHARED_EXPORT AssetCache
+{
+public:
+  //################################################################################################
+  struct Key
+  {
+    uint64_t hash{0};
+    size_t size{0};
+
+    bool operator==(const Key& other) const
+    {
+      return hash == other.hash && size == other.size;
+    }
+  };
+
+  //################################################################################################
+  AssetCache();
+
+  //################################################################################################
+  ~AssetCache();
+
+  //################################################################################################
+  //! FNV-1a hash and size of the source data, used as the content address of the decoded asset.
+  static Key keyForData(const void* data, size_t size);
+
+  //################################################################################################
+  //! Return the cached asset or call decode, which returns the asset and sets its size in bytes.
+  template<typename T>
+  std::shared_ptr<const T> fetch(Key key, const std::function<std::shared_ptr<const T>(size_t& bytes)>& decode)
+  {
+    if(auto asset = find(key, typeid(T)); asset)
+      return std::static_pointer_cast<const T>(asset);
+
+    size_t bytes=0;
+    std::shared_ptr<const T> asset = decode(bytes);
+    if(asset)
+      insert(key, typeid(T), asset, bytes);
+    return asset;
+  }
+
+  //################################################################################################
+  //! Return the cached asset or nullptr, an asset cached under a different type is not returned.
+  template<typename T>
+  std::shared_ptr<const T> find(Key key)
+  {
+    return std::static_pointer_cast<const T>(find(key, typeid(T)));
+  }
+
+  //################################################################################################
+  //! Add or replace an asset, returns false if the key is held by an asset that can't be replaced.
+  /*!
+  An asset cached under the key with a different type, or one that is still in use, is kept and
+  the new asset is not cached, use find() to get the cached one.
+  */
+  template<typename T>
+  bool insert(Key key, const std::shared_ptr<const T>& asset, size_t bytes)
+  {
+    return insert(key, typeid(T), asset, bytes);
+  }
+
+  //################################################################################################
+  //! Evict unused assets until the cache fits within maxBytes, the default is 64MB.
+  void setMaxBytes(size_t maxBytes);
+
+  //################################################################################################
+  size_t maxBytes() const;
+
+  //################################################################################################
+  //! Bytes held by the cache including assets that are still in use.
+  size_t bytes() const;
+
+  //################################################################################################
+  size_t count() const;
+
+  //################################################################################################
+  size_t hits() const;
+
+  //################################################################################################
+  size_t misses() const;
+
+  //################################################################################################
+  //! Evict unused assets that do not fit, assets released since the last insert are freed here.
+  void trim();
+
+  //################################################################################################
+  //! Drop the cache's reference to every asset.
+  void clear();
+
+private:
+  //################################################################################################
+  std::shared_ptr<const void> find(Key key, const std::type_info& type);
+
+  //################################################################################################
+  bool insert(Key key, const std::type_info& type, const std::shared_ptr<const void>& asset, size_t bytes);
+
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
+
+#endif
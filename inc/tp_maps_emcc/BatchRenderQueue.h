@@ -0,0 +1,112 @@
+#ifndef tp_maps_emcc_BatchRenderQueue_h
+#define tp_maps_emcc_BatchRenderQueue_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+namespace tp_maps
+{
+class Map;
+}
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+struct BatchRenderResult
+{
+  size_t jobID{0};
+  int width{0};
+  int height{0};
+  bool success{false};
+  bool timedOut{false};        //!< The view was rendered before it reported ready.
+  std::vector<uint8_t> pixels; //!< RGBA, bottom row first as returned by glReadPixels.
+};
+
+//##################################################################################################
+//! A single view to render.
+struct BatchRenderJob
+{
+  int width{256};
+  int height{256};
+
+  //! Called before rendering to set up the camera and layers for this view.
+  std::function<void(tp_maps::Map*)> prepare;
+
+  //! Polled once per process() call after prepare, the view is rendered once it returns true.
+  /*!
+  Use this to wait for textures or models that load asynchronously, if not set the ready function
+  passed to the queue is used. After timeoutMS the view is rendered anyway.
+  */
+  std::function<bool(tp_maps::Map*)> ready;
+  double timeoutMS{5000.0};
+
+  //! Called with the pixels once rendered.
+  std::function<void(BatchRenderResult&)> done;
+};
+
+//##################################################################################################
+//! Renders a queue of views back to back through a single map.
+/*!
+The queue itself is independent of the backend, the render function does the painting and
+readback. This allows it to be driven by any tp_maps::Map implementation.
+
+Jobs are rendered in order. Each job is prepared and then waits, holding the queue, until it is
+ready so that anything loaded by prepare is in the thumbnail.
+*/
+class TP_MAPS_EMCC_SHARED_EXPORT BatchRenderQueue
+{
+public:
+  using RenderFunction = std::function<bool(tp_maps::Map*, int width, int height, std::vector<uint8_t>& pixels)>;
+  using ReadyFunction = std::function<bool(tp_maps::Map*)>;
+  using ClockFunction = std::function<double()>;
+
+  //################################################################################################
+  //! ready is used for jobs that do not have their own, if not set those jobs are always ready.
+  BatchRenderQueue(tp_maps::Map* map, const RenderFunction& render, const ReadyFunction& ready=ReadyFunction());
+
+  //################################################################################################
+  ~BatchRenderQueue();
+
+  //################################################################################################
+  //! Replace the clock used for budgets and timeouts, it returns milliseconds from any fixed point.
+  /*!
+  This defaults to std::chrono::steady_clock, tests set it to drive time deterministically.
+  */
+  void setClock(const ClockFunction& clock);
+
+  //################################################################################################
+  //! Returns an ID that will be passed back in the result.
+  size_t enqueue(const BatchRenderJob& job);
+
+  //################################################################################################
+  size_t pending() const;
+
+  //################################################################################################
+  //! Render jobs back to back until the queue is empty, budgetMS has been used, or a job is not ready.
+  /*!
+  At least one job is attempted per call if any are pending.
+  \return The number of jobs rendered.
+  */
+  size_t process(double budgetMS);
+
+  //################################################################################################
+  //! Total number of jobs rendered.
+  size_t rendered() const;
+
+  //################################################################################################
+  //! Jobs rendered per second of time spent in process().
+  double thumbnailsPerSecond() const;
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
+
+#endif
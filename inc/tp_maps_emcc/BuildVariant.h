@@ -0,0 +1,36 @@
+#ifndef tp_maps_emcc_BuildVariant_h
+#define tp_maps_emcc_BuildVariant_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#if defined(__wasm_simd128__)
+#  define TP_MAPS_EMCC_SIMD
+#endif
+
+#if defined(__EMSCRIPTEN_PTHREADS__)
+#  define TP_MAPS_EMCC_THREADS
+#endif
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! The instruction set and threading options the library was compiled with.
+enum class BuildVariant
+{
+  Baseline,   //!< No SIMD or threads, runs in every browser with WebAssembly.
+  SIMD,       //!< Built with -msimd128.
+  SIMDThreads //!< Built with -msimd128 -pthread, needs a cross origin isolated page.
+};
+
+//##################################################################################################
+//! The variant of the library that is running, as compiled rather than as seen by the caller.
+BuildVariant TP_MAPS_EMCC_SHARED_EXPORT buildVariant();
+
+//##################################################################################################
+//! "baseline", "simd", or "simd-threads", matching the names used by the loader.
+const char* TP_MAPS_EMCC_SHARED_EXPORT buildVariantToString(BuildVariant buildVariant);
+
+}
+
+#endif
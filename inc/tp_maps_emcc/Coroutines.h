@@ -0,0 +1,235 @@
+#ifndef tp_maps_emcc_Coroutines_h
+#define tp_maps_emcc_Coroutines_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <cstdint>
+#include <cstddef>
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#define TP_MAPS_EMCC_COROUTINES
+#include "tp_maps_emcc/Map.h"
+#include "tp_maps_emcc/MapManager.h"
+
+#include "tp_utils/DebugUtils.h"
+#include "tp_utils/TimeUtils.h"
+
+#include <coroutine>
+#include <utility>
+#endif
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! A suspended coroutine, this is a member of the awaitable so queuing it does not allocate.
+struct CoroutineWaiter
+{
+  bool (*poll)(CoroutineWaiter*){nullptr};
+  void (*wake)(CoroutineWaiter*){nullptr};
+  void (*destroy)(CoroutineWaiter*){nullptr};
+  CoroutineWaiter* next{nullptr};
+};
+
+//##################################################################################################
+//! Intrusive list of suspended coroutines that is polled from the MapManager main loop.
+class TP_MAPS_EMCC_SHARED_EXPORT CoroutineScheduler
+{
+public:
+  //################################################################################################
+  CoroutineScheduler();
+
+  //################################################################################################
+  //! Coroutines still suspended are destroyed without being resumed, freeing their frames.
+  ~CoroutineScheduler();
+
+  //################################################################################################
+  //! The waiter must stay valid until it is resumed.
+  void suspend(CoroutineWaiter* waiter);
+
+  //################################################################################################
+  //! Resume every waiter that is ready, waiters added while resuming are polled on the next call.
+  void resume();
+
+  //################################################################################################
+  size_t suspended() const;
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+#ifdef TP_MAPS_EMCC_COROUTINES
+//##################################################################################################
+//! Fire and forget coroutine return type, the frame is freed when the coroutine finishes.
+/*!
+\code
+tp_maps_emcc::Task flyTo(tp_maps_emcc::MapManager& manager, tp_maps_emcc::Map* map)
+{
+  co_await tp_maps_emcc::mapReady(manager, map);
+  for(int i=0; i<60; i++)
+  {
+    moveCamera(map, i);
+    co_await tp_maps_emcc::nextFrame(manager, map);
+  }
+  co_await tp_maps_emcc::delay(manager, 500);
+  startLoading(map);
+}
+\endcode
+
+A coroutine that waits on a map must finish before the map is destroyed. Coroutines still
+suspended when the MapManager is destroyed are destroyed with it.
+*/
+struct Task
+{
+  struct promise_type
+  {
+    Task get_return_object(){return {};}
+    std::suspend_never initial_suspend() noexcept {return {};}
+    std::suspend_never final_suspend() noexcept {return {};}
+    void return_void(){}
+    void unhandled_exception(){tpWarning() << "Exception caught in tp_maps_emcc::Task!";}
+  };
+};
+
+//##################################################################################################
+//! Suspends until ready() of the derived awaitable returns true when polled by the main loop.
+template<typename Derived>
+struct PollAwaitable : CoroutineWaiter
+{
+  CoroutineScheduler& scheduler;
+  std::coroutine_handle<> handle;
+
+  //################################################################################################
+  PollAwaitable(CoroutineScheduler& scheduler_):
+    scheduler(scheduler_)
+  {
+
+  }
+
+  //################################################################################################
+  PollAwaitable(MapManager& manager):
+    scheduler(manager.coroutineScheduler())
+  {
+
+  }
+
+  //################################################################################################
+  bool await_ready()
+  {
+    return static_cast<Derived*>(this)->ready();
+  }
+
+  //################################################################################################
+  void await_suspend(std::coroutine_handle<> handle_)
+  {
+    handle = handle_;
+    poll = [](CoroutineWaiter* w){return static_cast<Derived*>(w)->ready();};
+    wake = [](CoroutineWaiter* w){static_cast<Derived*>(w)->handle.resume();};
+    destroy = [](CoroutineWaiter* w){static_cast<Derived*>(w)->handle.destroy();};
+    scheduler.suspend(this);
+  }
+
+  //################################################################################################
+  void await_resume(){}
+};
+
+//##################################################################################################
+//! Resumes after the map has painted another frame, a paint is requested so a static map still paints.
+struct NextFrame : PollAwaitable<NextFrame>
+{
+  Map* map;
+  size_t frame;
+  NextFrame(MapManager& manager, Map* map_):PollAwaitable(manager), map(map_), frame(map_->frameCount()){map->requestFrame();}
+  bool ready() const {return map->frameCount()>frame;}
+};
+
+//##################################################################################################
+//! Resumes after the next round of animate callbacks.
+struct NextAnimateTick : PollAwaitable<NextAnimateTick>
+{
+  MapManager& manager;
+  size_t tick;
+  NextAnimateTick(MapManager& manager_):PollAwaitable(manager_), manager(manager_), tick(manager_.animateTicks()){}
+  bool ready() const {return manager.animateTicks()>tick;}
+};
+
+//##################################################################################################
+//! Resumes once at least ms milliseconds have passed.
+struct Delay : PollAwaitable<Delay>
+{
+  int64_t until;
+  Delay(CoroutineScheduler& scheduler, int64_t ms):PollAwaitable(scheduler), until(tp_utils::currentTimeMS()+ms){}
+  Delay(MapManager& manager, int64_t ms):PollAwaitable(manager), until(tp_utils::currentTimeMS()+ms){}
+  bool ready() const {return tp_utils::currentTimeMS()>=until;}
+};
+
+//##################################################################################################
+//! Resumes once the map has painted its first frame, does not suspend if it already has.
+struct MapReady : PollAwaitable<MapReady>
+{
+  Map* map;
+  MapReady(MapManager& manager, Map* map_):PollAwaitable(manager), map(map_){}
+  bool ready() const {return map->frameCount()>0;}
+};
+
+//##################################################################################################
+//! Resumes once predicate returns true, used to wait for background jobs to complete.
+template<typename Predicate>
+struct Until : PollAwaitable<Until<Predicate>>
+{
+  Predicate predicate;
+  Until(CoroutineScheduler& scheduler, Predicate predicate_):PollAwaitable<Until<Predicate>>(scheduler), predicate(std::move(predicate_)){}
+  Until(MapManager& manager, Predicate predicate_):PollAwaitable<Until<Predicate>>(manager), predicate(std::move(predicate_)){}
+  bool ready(){return predicate();}
+};
+
+//##################################################################################################
+inline NextFrame nextFrame(MapManager& manager, Map* map)
+{
+  return NextFrame(manager, map);
+}
+
+//##################################################################################################
+inline NextAnimateTick nextAnimateTick(MapManager& manager)
+{
+  return NextAnimateTick(manager);
+}
+
+//##################################################################################################
+inline Delay delay(MapManager& manager, int64_t ms)
+{
+  return Delay(manager, ms);
+}
+
+//##################################################################################################
+inline MapReady mapReady(MapManager& manager, Map* map)
+{
+  return MapReady(manager, map);
+}
+
+//##################################################################################################
+inline Delay delay(CoroutineScheduler& scheduler, int64_t ms)
+{
+  return Delay(scheduler, ms);
+}
+
+//##################################################################################################
+template<typename Predicate>
+Until<Predicate> until(MapManager& manager, Predicate predicate)
+{
+  return Until<Predicate>(manager, std::move(predicate));
+}
+
+//##################################################################################################
+template<typename Predicate>
+Until<Predicate> until(CoroutineScheduler& scheduler, Predicate predicate)
+{
+  return Until<Predicate>(scheduler, std::move(predicate));
+}
+#endif
+
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef tp_maps_emcc_DataIngest_h
+#define tp_maps_emcc_DataIngest_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <functional>
+#include <string>
+#include <cstdint>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! A committed batch, the data remains valid until the stream is committed again.
+struct IngestBatch
+{
+  const uint8_t* data{nullptr};
+  size_t size{0};
+  size_t sequence{0};
+};
+
+//##################################################################################################
+//! Double buffered staging areas in the wasm heap that JavaScript writes into directly.
+/*!
+Each named stream owns two buffers. JavaScript acquires the back buffer, writes into the heap at the
+returned address, and commits it. Commit swaps the buffers without copying and the consumer for the
+stream is called from the main loop with the new front buffer, while the next batch can be written
+into the back buffer.
+
+If a stream is committed again before its consumer has been called the earlier batch is dropped,
+only the latest batch is delivered.
+
+From JavaScript, using the handle returned by MapManager::createMap and a stream name allocated
+with stringToNewUTF8:
+\code
+var ptr = _tp_maps_emcc_ingest_acquire(handle, stream, points.byteLength);
+HEAPF32.set(points, ptr>>2);
+_tp_maps_emcc_ingest_commit(handle, stream, points.byteLength);
+\endcode
+
+Acquire may grow the heap, so views such as HEAPF32 must be read after calling it.
+*/
+class TP_MAPS_EMCC_SHARED_EXPORT DataIngest
+{
+public:
+  using Deliver  = std::function<void(const std::function<void()>&)>;
+  using Consumer = std::function<void(const IngestBatch&)>;
+
+  //################################################################################################
+  //! deliver is used to call consumers from the main loop, normally Map::callAsync.
+  DataIngest(const Deliver& deliver);
+
+  //################################################################################################
+  ~DataIngest();
+
+  //################################################################################################
+  //! Set the function that receives committed batches for a stream.
+  void setConsumer(const std::string& stream, const Consumer& consumer);
+
+  //################################################################################################
+  //! Return the back buffer for a stream with room for at least size bytes.
+  uint8_t* acquire(const std::string& stream, size_t size);
+
+  //################################################################################################
+  //! Make the first size bytes of the back buffer the front buffer and schedule the consumer.
+  bool commit(const std::string& stream, size_t size);
+
+  //################################################################################################
+  //! Free both buffers of a stream.
+  void release(const std::string& stream);
+
+  //################################################################################################
+  //! Remove all streams, their buffers, and their consumers.
+  void clear();
+
+  //################################################################################################
+  //! Total bytes allocated across all streams.
+  size_t allocatedBytes() const;
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef tp_maps_emcc_FrameCapture_h
+#define tp_maps_emcc_FrameCapture_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! A frame read back from the default framebuffer.
+struct CapturedFrame
+{
+  int width{0};
+  int height{0};
+  size_t frameIndex{0};
+  std::vector<uint8_t> pixels; //!< RGBA, bottom row first as returned by glReadPixels.
+};
+
+//##################################################################################################
+//! Reads painted frames back without stalling the pipeline.
+/*!
+On WebGL 2 the pixels are read into a ring of pixel buffer objects and a fence is inserted, the
+buffer is only mapped back once the fence has signaled, typically a frame or two later. On WebGL 1
+there is no asynchronous path so the pixels are read synchronously but are still delivered later.
+
+All methods must be called with the owning context current.
+*/
+class TP_MAPS_EMCC_SHARED_EXPORT FrameCapture
+{
+public:
+  using Callback = std::function<void(const CapturedFrame&)>;
+  using Deliver  = std::function<void(const std::function<void()>&)>;
+
+  //################################################################################################
+  //! deliver is used to hand the finished frames to the callbacks, normally Map::callAsync.
+  FrameCapture(bool webGL2, const Deliver& deliver);
+
+  //################################################################################################
+  ~FrameCapture();
+
+  //################################################################################################
+  //! Capture the next painted frame.
+  void captureFrame(const Callback& callback);
+
+  //################################################################################################
+  //! Capture every painted frame until stopSequence() is called.
+  void startSequence(const Callback& callback);
+
+  //################################################################################################
+  void stopSequence();
+
+  //################################################################################################
+  //! Returns true if there is work queued or in flight.
+  bool active() const;
+
+  //################################################################################################
+  //! Returns true if a capture is waiting for a paint and there is a free slot to read it into.
+  bool needsFrame() const;
+
+  //################################################################################################
+  //! Number of sequence frames dropped because every readback slot was still in flight.
+  size_t droppedFrames() const;
+
+  //################################################################################################
+  //! Call after each paint, while the default framebuffer still holds the frame.
+  void framePainted(int width, int height);
+
+  //################################################################################################
+  //! Call once per main loop iteration to collect finished readbacks.
+  void poll();
+
+  //################################################################################################
+  //! Release all GL objects and reset the dropped count, pending callbacks are dropped.
+  void clear();
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
+
+#endif
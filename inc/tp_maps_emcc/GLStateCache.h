@@ -0,0 +1,43 @@
+#ifndef tp_maps_emcc_GLStateCache_h
+#define tp_maps_emcc_GLStateCache_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <emscripten/html5.h>
+
+#include <cstddef>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! Counts of state setting calls that were passed on to WebGL or dropped as redundant.
+struct GLCallStats
+{
+  size_t issued{0};
+  size_t elided{0};
+  size_t makeCurrentIssued{0};
+  size_t makeCurrentElided{0};
+};
+
+//##################################################################################################
+//! Shadow WebGL state on a context so that calls that would not change it never reach the browser.
+/*!
+This wraps the state setting methods of the context's WebGLRenderingContext object, covering bound
+programs, buffers, textures, framebuffers, renderbuffers, vertex arrays, enabled capabilities, blend,
+depth, cull, color mask, clear color, and viewport. Deleting an object clears any binding of it.
+
+It should be installed straight after the context is created, before any state has been set.
+Define TP_MAPS_EMCC_NO_GL_STATE_CACHE to compile it out.
+*/
+void TP_MAPS_EMCC_SHARED_EXPORT installGLStateCache(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context);
+
+//##################################################################################################
+//! Write the issued and elided counts for the context into stats, optionally resetting them.
+void TP_MAPS_EMCC_SHARED_EXPORT glStateCacheStats(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context,
+                                                  GLCallStats& stats,
+                                                  bool reset);
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef tp_maps_emcc_InputLatency_h
+#define tp_maps_emcc_InputLatency_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <array>
+#include <string>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+enum class InputEventType
+{
+  Mouse,
+  Wheel,
+  Touch
+};
+
+//##################################################################################################
+std::string TP_MAPS_EMCC_SHARED_EXPORT inputEventTypeToString(InputEventType type);
+
+//##################################################################################################
+//! Latency from an input event arriving to the end of the first paint that follows it.
+struct TP_MAPS_EMCC_SHARED_EXPORT InputLatencyStats
+{
+  //! Bucket 0 is <1ms, bucket n is [2^(n-1), 2^n) ms, the last bucket holds everything above.
+  static constexpr size_t bucketCount{12};
+  std::array<size_t, bucketCount> histogram{};
+
+  size_t count{0};
+  double totalMS{0.0};
+  double maxMS{0.0};
+  InputEventType worstEventType{InputEventType::Mouse};
+
+  //! The worst latency seen for each InputEventType.
+  std::array<double, 3> maxMSByType{};
+
+  //################################################################################################
+  double meanMS() const;
+
+  //################################################################################################
+  //! Returns the lower bound in milliseconds of the bucket.
+  static double bucketLowerMS(size_t bucket);
+
+  //################################################################################################
+  void addSample(InputEventType type, double latencyMS);
+};
+
+//##################################################################################################
+//! Tracks input events from arrival until a paint completes.
+/*!
+Timestamps are in milliseconds from the same clock, normally the DOM event timeStamp for arrival and
+emscripten_get_now() for the end of the paint. Up to a fixed number of events are held between
+paints, if more arrive the newest are ignored as they can not be the worst case.
+*/
+class TP_MAPS_EMCC_SHARED_EXPORT InputLatencyTracker
+{
+public:
+  //################################################################################################
+  void eventReceived(InputEventType type, double timeMS);
+
+  //################################################################################################
+  //! Record a sample for each pending event.
+  void paintFinished(double timeMS);
+
+  //################################################################################################
+  const InputLatencyStats& stats() const;
+
+  //################################################################################################
+  void reset();
+
+private:
+  struct Pending_lt
+  {
+    InputEventType type;
+    double timeMS;
+  };
+
+  std::array<Pending_lt, 64> m_pending;
+  size_t m_pendingCount{0};
+  InputLatencyStats m_stats;
+};
+
+}
+
+#endif
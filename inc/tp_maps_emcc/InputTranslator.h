@@ -0,0 +1,117 @@
+#ifndef tp_maps_emcc_InputTranslator_h
+#define tp_maps_emcc_InputTranslator_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include "tp_maps/MouseEvent.h"
+
+#include <functional>
+#include <cstdint>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+enum class MouseInputType
+{
+  Down,
+  Up,
+  DoubleClick,
+  Move,
+  Leave
+};
+
+//##################################################################################################
+//! A browser mouse event reduced to the fields that the translation uses.
+struct MouseInput
+{
+  MouseInputType type{MouseInputType::Move};
+  int button{0};            //!< 0: Left, 1: Middle, 2: Right
+  double targetX{0.0};      //!< CSS pixels relative to the canvas.
+  double targetY{0.0};
+  int movementX{0};         //!< Only used when pointerLocked is true.
+  int movementY{0};
+  bool pointerLocked{false};
+  tp_maps::KeyboardModifier modifiers{tp_maps::KeyboardModifier::None};
+  double eventTimeMS{0.0};  //!< DOM event.timeStamp, 0 if unknown.
+};
+
+//##################################################################################################
+struct WheelInput
+{
+  double deltaY{0.0};
+  tp_maps::KeyboardModifier modifiers{tp_maps::KeyboardModifier::None};
+  double eventTimeMS{0.0};  //!< DOM event.timeStamp, 0 if unknown.
+};
+
+//##################################################################################################
+enum class TouchInputType
+{
+  Start,
+  End,
+  Move,
+  Cancel
+};
+
+//##################################################################################################
+struct TouchPoint
+{
+  double targetX{0.0};
+  double targetY{0.0};
+};
+
+//##################################################################################################
+//! A browser touch event, only the first two touch points are used.
+struct TouchInput
+{
+  TouchInputType type{TouchInputType::Start};
+  int numTouches{0};
+  TouchPoint touches[2];
+  int64_t timeMS{0};
+  tp_maps::KeyboardModifier modifiers{tp_maps::KeyboardModifier::None};
+  double eventTimeMS{0.0};  //!< DOM event.timeStamp, 0 if unknown.
+};
+
+//##################################################################################################
+//! Translates browser mouse, wheel, and touch input into tp_maps mouse events.
+/*!
+This holds the scaling, double tap detection, touch mode state machine, and pointer lock
+accumulation. It has no dependency on Emscripten so that it can be driven by synthetic event
+streams natively.
+*/
+class TP_MAPS_EMCC_SHARED_EXPORT InputTranslator
+{
+public:
+  //################################################################################################
+  InputTranslator(const std::function<void(const tp_maps::MouseEvent&)>& mouseEvent);
+
+  //################################################################################################
+  ~InputTranslator();
+
+  //################################################################################################
+  void setPixelScale(float pixelScale);
+
+  //################################################################################################
+  float pixelScale() const;
+
+  //################################################################################################
+  const glm::ivec2& mousePos() const;
+
+  //################################################################################################
+  void mouseInput(const MouseInput& input);
+
+  //################################################################################################
+  void wheelInput(const WheelInput& input);
+
+  //################################################################################################
+  void touchInput(const TouchInput& input);
+
+private:
+  struct Private;
+  Private* d;
+  friend struct Private;
+};
+
+}
+
+#endif
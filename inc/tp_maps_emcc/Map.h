@@ -7,13 +7,25 @@
 
 namespace tp_maps_emcc
 {
+struct CapturedFrame;
+struct InputLatencyStats;
+struct MouseInput;
+struct WheelInput;
+struct TouchInput;
+class DataIngest;
+struct GLCallStats;
+struct GPUMemoryStats;
 
 //##################################################################################################
 class TP_MAPS_EMCC_SHARED_EXPORT Map : public tp_maps::Map
 {
 public:
   //################################################################################################
-  Map(const char* canvasID, bool enableDepthBuffer = true);
+  /*!
+  \param installEventHandlers Register html5 input callbacks on the canvas. Maps created by a
+  MapManager do not, the manager routes input to them from a shared set of listeners.
+  */
+  Map(const char* canvasID, bool enableDepthBuffer = true, bool installEventHandlers = true);
 
   //################################################################################################
   virtual ~Map();
@@ -21,9 +33,44 @@ public:
   //################################################################################################
   const std::string& canvasID()const;
 
+  //################################################################################################
+  //! True if the context could not be created or made current.
+  bool hasError() const;
+
+  //################################################################################################
+  //! Delete the layers and drop queued callbacks, captures, and staged data so the map can be pooled.
+  /*!
+  Pointer lock, progressive rendering, and the frame, capture, input latency, and GL call counters
+  are returned to their defaults. The context, canvas, and size survive pooling, as does any state
+  held by tp_maps::Map other than the layers.
+  */
+  void recycle();
+
+  //################################################################################################
+  //! Bind this map to the canvas matching canvasID, returns false if it can't.
+  /*!
+  The canvas element of a context can't be changed, so by default this only succeeds if canvasID
+  matches the canvas this map already renders to. With replaceCanvas the canvas of this map instead
+  replaces the element matching canvasID in the DOM, taking its id, class, and style. The replaced
+  element is detached, so only use this if nothing else, such as a UI framework, holds on to it.
+  */
+  bool rebind(const char* canvasID, bool replaceCanvas=false);
+
   //################################################################################################
   void processEvents();
 
+  //################################################################################################
+  //! Run the callbacks queued with callAsync without painting, processEvents() also does this.
+  void processAsyncCallbacks();
+
+  //################################################################################################
+  //! The number of frames painted by processEvents().
+  size_t frameCount() const;
+
+  //################################################################################################
+  //! Paint on the next processEvents() even if nothing has changed.
+  void requestFrame();
+
   //################################################################################################
   void makeCurrent() override;
 
@@ -34,6 +81,10 @@ public:
   //################################################################################################
   void callAsync(const std::function<void()>& callback) override;
 
+  //################################################################################################
+  //! True if callbacks queued with callAsync are waiting for the next processEvents().
+  bool asyncCallbacksPending() const;
+
   //################################################################################################
   float pixelScale() const override;
 
@@ -41,9 +92,92 @@ public:
   //! Call this when the window is resized (this will become protected shortly)
   void resize();
 
+  //################################################################################################
+  //! Feed input into the map, called from the html5 callbacks or by a MapManager.
+  void mouseInput(const MouseInput& input);
+
+  //################################################################################################
+  void wheelInput(const WheelInput& input);
+
+  //################################################################################################
+  void touchInput(const TouchInput& input);
+
+  //################################################################################################
+  //! Staging buffers that JavaScript can write bulk data into without copying.
+  DataIngest& dataIngest();
+
   //################################################################################################
   void setUsePointerLock(bool usePointerLock);
 
+  //################################################################################################
+  //! Resize the drawing buffer if required, paint, and read the pixels back synchronously.
+  /*!
+  This is intended for maps that are not on screen, such as the one used for batch rendering. The
+  canvas CSS size is not touched.
+  */
+  bool renderToPixels(int width, int height, std::vector<uint8_t>& pixels);
+
+  //################################################################################################
+  //! Paint at reduced resolution while the view is changing and refine once it settles.
+  /*!
+  When enabled each new update is painted at the finest of 1/4, 1/2, or full resolution that last
+  fitted inside frameBudgetMS, including the cost of changing level. Once no update has arrived for
+  150ms the frame is painted again at full resolution.
+
+  Levels set the size of the canvas drawing buffer and call resizeGL, so tp_maps renders every pass
+  into smaller targets, while the CSS size is unchanged and the browser scales the result up. The
+  level is held while updates keep arriving so render targets are only reallocated when the view
+  starts and stops changing.
+
+  tp_maps paints a frame in a single paintGL call, so the full resolution paint is not time sliced.
+  It is put off until the view has settled so that it does not delay input while interacting.
+  */
+  void setProgressiveRendering(bool progressive, double frameBudgetMS=16.0);
+
+  //################################################################################################
+  bool progressiveRendering() const;
+
+  //################################################################################################
+  //! Read the next frame back without blocking, the callback is called via callAsync.
+  void captureFrameAsync(const std::function<void(const CapturedFrame&)>& callback);
+
+  //################################################################################################
+  //! Capture a frame per main loop iteration until stopFrameSequenceCapture() is called.
+  /*!
+  The map repaints every iteration while a sequence is active, waiting for a readback slot to be
+  free, so a static view is captured at the readback rate. Progressive rendering is suspended.
+  */
+  void startFrameSequenceCapture(const std::function<void(const CapturedFrame&)>& callback);
+
+  //################################################################################################
+  void stopFrameSequenceCapture();
+
+  //################################################################################################
+  //! Sequence frames dropped because the GPU had not finished the previous readbacks.
+  size_t droppedCaptureFrames() const;
+
+  //################################################################################################
+  //! Time from the DOM timeStamp of mouse, wheel, and touch events to the end of the next paint.
+  /*!
+  Only events that request an update while being handled are timed, input with no visible effect
+  such as idle mouse moves is not counted.
+  */
+  const InputLatencyStats& inputLatencyStats() const;
+
+  //################################################################################################
+  void resetInputLatencyStats();
+
+  //################################################################################################
+  //! WebGL state calls and make current calls that were issued or dropped as redundant.
+  GLCallStats glCallStats() const;
+
+  //################################################################################################
+  void resetGLCallStats();
+
+  //################################################################################################
+  //! Estimated GPU memory held by this map's context, including its drawing buffer.
+  GPUMemoryStats gpuMemoryStats() const;
+
 private:
   struct Private;
   Private* d;
@@ -10,6 +10,10 @@
 namespace tp_maps_emcc
 {
 class Map;
+struct BatchRenderJob;
+class AssetCache;
+class CoroutineScheduler;
+struct MemoryStats;
 
 //##################################################################################################
 struct MapDetails
@@ -21,6 +25,14 @@ struct MapDetails
 
   //################################################################################################
   virtual ~MapDetails();
+
+  //################################################################################################
+  //! True while being destroyed if the map is being returned to the pool rather than deleted.
+  bool recycleMap() const;
+
+private:
+  friend class MapManager;
+  bool m_recycleMap{false};
 };
 
 //##################################################################################################
@@ -42,9 +54,85 @@ public:
   //################################################################################################
   void destroyMap(void* handle);
 
+  //################################################################################################
+  //! Keep up to mapPoolSize destroyed maps and their contexts for reuse by createMap.
+  /*!
+  A pooled map keeps its context and canvas. By default it is only reused when createMap is called
+  for the same canvas element, for example when a view is destroyed and created again on a canvas
+  the application keeps. With replaceCanvas any pooled map can be reused, its canvas replaces the
+  element passed to createMap in the DOM taking its id, class, and style. Only enable this if the
+  application does not hold on to its canvas elements, a UI framework that does will be left with
+  a detached element.
+
+  Pooled contexts count towards the browser's limit of live WebGL contexts per page, 16 in Chrome,
+  beyond which the oldest context is lost. The pool is trimmed so that pooled, visible, and batch
+  render maps together stay within 16, visible maps always take priority.
+
+  The layers of a map are deleted when it is pooled and the createMapDetails function is called
+  again on reuse. The default size of 0 disables pooling.
+  */
+  void setMapPoolSize(size_t mapPoolSize, bool replaceCanvas=false);
+
+  //################################################################################################
+  //! Pooled maps that have not been reused within mapPoolIdleTimeoutMS are destroyed.
+  void setMapPoolIdleTimeout(int64_t mapPoolIdleTimeoutMS);
+
+  //################################################################################################
+  //! Queue a view to be rendered through a shared offscreen map.
+  /*!
+  A single hidden canvas and context are created the first time this is called and reused for
+  every job. The map is set up with the createMapDetails function passed to the constructor. Jobs
+  are rendered back to back from the main loop within the batch render budget. Unless the job has
+  its own ready function, a job is rendered once the map has no callAsync work left from prepare.
+
+  \return An ID that will be passed back in the result.
+  */
+  size_t enqueueBatchRender(const BatchRenderJob& job);
+
+  //################################################################################################
+  size_t batchRenderPending() const;
+
+  //################################################################################################
+  //! Milliseconds per main loop iteration to spend rendering batch jobs, at least one job is done.
+  void setBatchRenderBudget(double batchRenderBudgetMS);
+
+  //################################################################################################
+  double batchThumbnailsPerSecond() const;
+
+  //################################################################################################
+  //! Decoded assets shared by all the maps created by this manager.
+  AssetCache& assetCache();
+
+  //################################################################################################
+  //! Coroutines awaiting frames, ticks, delays, or jobs, resumed once per main loop iteration.
+  CoroutineScheduler& coroutineScheduler();
+
+  //################################################################################################
+  //! The number of times animateCallbacks have been called.
+  size_t animateTicks() const;
+
+  //################################################################################################
+  //! Heap usage and the estimated GPU memory of every map, including pooled maps.
+  /*!
+  See Map::gpuMemoryStats() for how the GPU memory of each map is estimated.
+  */
+  MemoryStats memoryStats();
+
+  //################################################################################################
+  //! Call memoryLimitCallbacks when heap use or total GPU memory goes over a limit, 0 disables it.
+  /*!
+  Memory is checked once a second, the GPU limit includes pooled maps. The callbacks are called once
+  when a limit is crossed, and not again until usage has dropped back under the limit, giving the
+  application a chance to drop caches before the browser fails an allocation or loses the context.
+  */
+  void setMemorySoftLimits(size_t heapBytes, size_t gpuBytes);
+
   //################################################################################################
   tp_utils::CallbackCollection<void(double)> animateCallbacks;
 
+  //################################################################################################
+  tp_utils::CallbackCollection<void(const MemoryStats&)> memoryLimitCallbacks;
+
 private:
   struct Private;
   Private* d;
@@ -0,0 +1,87 @@
+#ifndef tp_maps_emcc_MemoryAccounting_h
+#define tp_maps_emcc_MemoryAccounting_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <emscripten/html5.h>
+
+#include <cstddef>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! Estimated GPU memory held by a context, from the sizes passed to WebGL rather than the driver.
+struct GPUMemoryStats
+{
+  size_t bufferBytes{0};
+  size_t textureBytes{0};
+  size_t renderbufferBytes{0};
+
+  //! Color plus depth and stencil of the canvas drawing buffer at its current size.
+  size_t drawingBufferBytes{0};
+
+  //################################################################################################
+  size_t totalBytes() const
+  {
+    return bufferBytes + textureBytes + renderbufferBytes + drawingBufferBytes;
+  }
+};
+
+//##################################################################################################
+//! Size of the wasm heap and how much of it malloc is using.
+/*!
+These are sampled by the MapManager main loop once a second and on each call to memoryStats(),
+growth and peaks between samples are not seen.
+*/
+struct HeapStats
+{
+  //! The heap can only grow, so this is also its high water mark.
+  size_t heapBytes{0};
+
+  //! Samples where the heap had grown since the previous one, which may cover several growths.
+  size_t samplesWithHeapGrowth{0};
+
+  size_t usedBytes{0};
+  size_t peakSampledUsedBytes{0};
+};
+
+//##################################################################################################
+//! Total memory across all the maps of a MapManager.
+struct MemoryStats
+{
+  HeapStats heap;
+
+  //! The maps in use, including the batch render map.
+  GPUMemoryStats gpu;
+
+  //! Maps held in the pool for reuse, these are not included in gpu.
+  GPUMemoryStats pooledGPU;
+
+  //################################################################################################
+  size_t totalGPUBytes() const
+  {
+    return gpu.totalBytes() + pooledGPU.totalBytes();
+  }
+};
+
+//##################################################################################################
+//! Track the size of buffers, textures, and renderbuffers allocated through a context.
+/*!
+This wraps the allocating and deleting methods of the context's WebGLRenderingContext object. It
+should be installed straight after the context is created and after installGLStateCache, it reads
+the bindings from the state cache's shadow and only wraps the bind methods itself if the cache has
+been compiled out. Define TP_MAPS_EMCC_NO_MEMORY_ACCOUNTING to compile it out.
+*/
+void TP_MAPS_EMCC_SHARED_EXPORT installGPUMemoryAccounting(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context);
+
+//##################################################################################################
+void TP_MAPS_EMCC_SHARED_EXPORT gpuMemoryStats(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, GPUMemoryStats& stats);
+
+//##################################################################################################
+//! Update stats with the current heap size and malloc usage.
+void TP_MAPS_EMCC_SHARED_EXPORT sampleHeapStats(HeapStats& stats);
+
+}
+
+#endif
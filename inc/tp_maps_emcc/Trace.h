@@ -0,0 +1,83 @@
+#ifndef tp_maps_emcc_Trace_h
+#define tp_maps_emcc_Trace_h
+
+#include "tp_maps_emcc/Globals.h"
+
+#include <string>
+#include <cstdint>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+//! Set by setTraceEnabled(), read inline so that disabled trace scopes cost a single branch.
+extern TP_MAPS_EMCC_SHARED_EXPORT bool traceEnabledFlag;
+
+//##################################################################################################
+//! Start or stop recording main loop spans.
+/*!
+\param enabled True to start recording.
+\param capacity The size of the ring buffer, once full the oldest spans are overwritten.
+\param emitPerformanceMeasures Also emit each span as start and end performance.mark() entries and
+a performance.measure() between them in the browser. This costs a call into JavaScript per span and
+the entries are not bounded by capacity, they are cleared by clearTrace() and when tracing is
+disabled.
+*/
+void TP_MAPS_EMCC_SHARED_EXPORT setTraceEnabled(bool enabled,
+                                                size_t capacity=65536,
+                                                bool emitPerformanceMeasures=false);
+
+//##################################################################################################
+inline bool traceEnabled()
+{
+  return traceEnabledFlag;
+}
+
+//##################################################################################################
+//! Discard all recorded spans and any performance marks and measures emitted for them.
+void TP_MAPS_EMCC_SHARED_EXPORT clearTrace();
+
+//##################################################################################################
+//! Return the recorded spans in Chrome trace event format, load this in chrome://tracing.
+std::string TP_MAPS_EMCC_SHARED_EXPORT traceToChromeJSON();
+
+//##################################################################################################
+//! Records a begin/end span for the lifetime of the object.
+/*!
+name must be a string literal, detail is copied and truncated. Nothing is done if tracing was not
+enabled when the scope was entered.
+*/
+class TP_MAPS_EMCC_SHARED_EXPORT TraceScope
+{
+public:
+  //################################################################################################
+  TraceScope(const char* name, const char* detail=nullptr, int64_t index=-1):
+    m_name(traceEnabledFlag?name:nullptr)
+  {
+    if(m_name)
+      begin(detail, index);
+  }
+
+  //################################################################################################
+  ~TraceScope()
+  {
+    if(m_name)
+      end();
+  }
+
+private:
+  //################################################################################################
+  void begin(const char* detail, int64_t index);
+
+  //################################################################################################
+  void end();
+
+  const char* m_name;
+  const char* m_detail{nullptr};
+  int64_t m_index{-1};
+  double m_begin{0.0};
+};
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+// Picks the fastest build variant of an application using tp_maps_emcc that the browser can run.
+//
+// Usage:
+//   tpMapsEmccLoadVariant("app", {locateFile: ...}).then(function(variant) { ... });
+//
+// This expects the variants to be built into sibling directories named after the variant, each
+// containing <name>.js and <name>.wasm:
+//   baseline/app.js  simd/app.js  simd-threads/app.js
+(function(global) {
+  "use strict";
+
+  // A module with a single function using i8x16.splat and i8x16.popcnt, invalid without SIMD support.
+  var simdModule = new Uint8Array([
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00, 0x01, 0x05, 0x01, 0x60, 0x00, 0x01, 0x7b, 0x03,
+    0x02, 0x01, 0x00, 0x0a, 0x0a, 0x01, 0x08, 0x00, 0x41, 0x00, 0xfd, 0x0f, 0xfd, 0x62, 0x0b
+  ]);
+
+  function supportsSIMD() {
+    try {
+      return WebAssembly.validate(simdModule);
+    }
+    catch(e) {
+      return false;
+    }
+  }
+
+  // Threads need SharedArrayBuffer, which browsers only expose to cross origin isolated pages.
+  function supportsThreads() {
+    if(typeof SharedArrayBuffer === "undefined" || !global.crossOriginIsolated)
+      return false;
+    try {
+      new WebAssembly.Memory({initial: 1, maximum: 1, shared: true});
+      return true;
+    }
+    catch(e) {
+      return false;
+    }
+  }
+
+  function detectVariant() {
+    if(typeof WebAssembly !== "object")
+      return null;
+
+    var simd = supportsSIMD();
+    if(simd && supportsThreads())
+      return "simd-threads";
+    if(simd)
+      return "simd";
+    return "baseline";
+  }
+
+  function loadScript(src) {
+    return new Promise(function(resolve, reject) {
+      var script = document.createElement("script");
+      script.src = src;
+      script.onload = resolve;
+      script.onerror = function() { reject(new Error("Failed to load: " + src)); };
+      document.head.appendChild(script);
+    });
+  }
+
+  // Set Module before loading, Emscripten picks it up from the global scope.
+  global.tpMapsEmccLoadVariant = function(name, module, baseURL) {
+    var variant = detectVariant();
+    if(!variant)
+      return Promise.reject(new Error("WebAssembly is not supported."));
+
+    var prefix = (baseURL || "") + variant + "/";
+    module = module || {};
+    if(!module.locateFile)
+      module.locateFile = function(path) { return prefix + path; };
+    global.Module = module;
+
+    return loadScript(prefix + name + ".js").then(function() { return variant; });
+  };
+
+  global.tpMapsEmccDetectVariant = detectVariant;
+})(typeof window !== "undefined" ? window : self);
@@ -0,0 +1,187 @@
+#include "tp_maps_emcc/AssetCache.h"
+
+#include <unordered_map>
+#include <list>
+#include <typeindex>
+#include <iterator>
+
+namespace tp_maps_emcc
+{
+
+namespace
+{
+//##################################################################################################
+struct KeyHash_lt
+{
+  size_t operator()(const AssetCache::Key& key) const
+  {
+    return std::hash<uint64_t>()(key.hash ^ (uint64_t(key.size) * 0x9E3779B97F4A7C15ull));
+  }
+};
+
+//##################################################################################################
+struct Entry_lt
+{
+  std::shared_ptr<const void> asset;
+  std::type_index type{typeid(void)};
+  size_t bytes{0};
+  std::list<AssetCache::Key>::iterator lru;
+};
+}
+
+//##################################################################################################
+struct AssetCache::Private
+{
+  std::unordered_map<Key, Entry_lt, KeyHash_lt> entries;
+
+  // Most recently used at the front.
+  std::list<Key> lru;
+
+  size_t maxBytes{64*1024*1024};
+  size_t bytes{0};
+  size_t hits{0};
+  size_t misses{0};
+
+  //################################################################################################
+  void erase(std::unordered_map<Key, Entry_lt, KeyHash_lt>::iterator i)
+  {
+    bytes -= i->second.bytes;
+    lru.erase(i->second.lru);
+    entries.erase(i);
+  }
+
+  //################################################################################################
+  void trim()
+  {
+    // Walk back from the least recently used end, k stays valid as only the node before it is erased.
+    for(auto k=lru.end(); k!=lru.begin() && bytes>maxBytes;)
+    {
+      auto prev = std::prev(k);
+      auto i = entries.find(*prev);
+
+      // Only evict assets that no map is still using.
+      if(i->second.asset.use_count() == 1)
+        erase(i);
+      else
+        k = prev;
+    }
+  }
+};
+
+//##################################################################################################
+AssetCache::AssetCache():
+  d(new Private())
+{
+
+}
+
+//##################################################################################################
+AssetCache::~AssetCache()
+{
+  delete d;
+}
+
+//##################################################################################################
+AssetCache::Key AssetCache::keyForData(const void* data, size_t size)
+{
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint64_t hash = 14695981039346656037ull;
+  for(size_t i=0; i<size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return Key{hash, size};
+}
+
+//##################################################################################################
+void AssetCache::setMaxBytes(size_t maxBytes)
+{
+  d->maxBytes = maxBytes;
+  d->trim();
+}
+
+//##################################################################################################
+size_t AssetCache::maxBytes() const
+{
+  return d->maxBytes;
+}
+
+//##################################################################################################
+size_t AssetCache::bytes() const
+{
+  return d->bytes;
+}
+
+//##################################################################################################
+size_t AssetCache::count() const
+{
+  return d->entries.size();
+}
+
+//##################################################################################################
+size_t AssetCache::hits() const
+{
+  return d->hits;
+}
+
+//##################################################################################################
+size_t AssetCache::misses() const
+{
+  return d->misses;
+}
+
+//##################################################################################################
+void AssetCache::trim()
+{
+  d->trim();
+}
+
+//##################################################################################################
+void AssetCache::clear()
+{
+  d->entries.clear();
+  d->lru.clear();
+  d->bytes = 0;
+}
+
+//##################################################################################################
+std::shared_ptr<const void> AssetCache::find(Key key, const std::type_info& type)
+{
+  auto i = d->entries.find(key);
+  if(i == d->entries.end() || i->second.type != type)
+  {
+    d->misses++;
+    return nullptr;
+  }
+
+  d->hits++;
+  d->lru.splice(d->lru.begin(), d->lru, i->second.lru);
+  return i->second.asset;
+}
+
+//##################################################################################################
+bool AssetCache::insert(Key key, const std::type_info& type, const std::shared_ptr<const void>& asset, size_t bytes)
+{
+  if(auto i = d->entries.find(key); i != d->entries.end())
+  {
+    // Replacing an asset that maps still share would stop its bytes being counted.
+    if(i->second.type != type || i->second.asset.use_count() > 1)
+      return false;
+    d->erase(i);
+  }
+
+  d->lru.push_front(key);
+
+  Entry_lt& entry = d->entries[key];
+  entry.asset = asset;
+  entry.type = type;
+  entry.bytes = bytes;
+  entry.lru = d->lru.begin();
+
+  d->bytes += bytes;
+  d->trim();
+  return true;
+}
+
+}
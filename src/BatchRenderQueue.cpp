@@ -0,0 +1,157 @@
+#include "tp_maps_emcc/BatchRenderQueue.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <deque>
+#include <chrono>
+
+namespace tp_maps_emcc
+{
+
+namespace
+{
+//##################################################################################################
+struct QueuedJob_lt
+{
+  size_t jobID;
+  BatchRenderJob job;
+  bool prepared;
+  double preparedAtMS;
+};
+}
+
+//##################################################################################################
+struct BatchRenderQueue::Private
+{
+  tp_maps::Map* map;
+  RenderFunction render;
+  ReadyFunction ready;
+  ClockFunction clock;
+
+  std::deque<QueuedJob_lt> jobs;
+  size_t nextJobID{1};
+
+  size_t rendered{0};
+  double renderSeconds{0.0};
+
+  //################################################################################################
+  Private(tp_maps::Map* map_, const RenderFunction& render_, const ReadyFunction& ready_):
+    map(map_),
+    render(render_),
+    ready(ready_),
+    clock(steadyClockMS)
+  {
+
+  }
+
+  //################################################################################################
+  static double steadyClockMS()
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+//##################################################################################################
+BatchRenderQueue::BatchRenderQueue(tp_maps::Map* map, const RenderFunction& render, const ReadyFunction& ready):
+  d(new Private(map, render, ready))
+{
+
+}
+
+//##################################################################################################
+BatchRenderQueue::~BatchRenderQueue()
+{
+  delete d;
+}
+
+//##################################################################################################
+void BatchRenderQueue::setClock(const ClockFunction& clock)
+{
+  d->clock = clock?clock:Private::steadyClockMS;
+}
+
+//##################################################################################################
+size_t BatchRenderQueue::enqueue(const BatchRenderJob& job)
+{
+  size_t jobID = d->nextJobID++;
+  d->jobs.push_back({jobID, job, false, 0.0});
+  return jobID;
+}
+
+//##################################################################################################
+size_t BatchRenderQueue::pending() const
+{
+  return d->jobs.size();
+}
+
+//##################################################################################################
+size_t BatchRenderQueue::process(double budgetMS)
+{
+  double startMS = d->clock();
+  double deadlineMS = startMS + budgetMS;
+
+  size_t count=0;
+  for(bool first=true; !d->jobs.empty() && (first || d->clock()<deadlineMS); first=false)
+  {
+    QueuedJob_lt& queued = d->jobs.front();
+
+    BatchRenderResult result;
+    result.jobID = queued.jobID;
+    result.width = queued.job.width;
+    result.height = queued.job.height;
+
+    try
+    {
+      if(!queued.prepared)
+      {
+        queued.prepared = true;
+        queued.preparedAtMS = d->clock();
+        if(queued.job.prepare)
+          queued.job.prepare(d->map);
+      }
+
+      const ReadyFunction& ready = queued.job.ready?queued.job.ready:d->ready;
+      if(ready && !ready(d->map))
+      {
+        if((d->clock()-queued.preparedAtMS)<queued.job.timeoutMS)
+          break;
+
+        tpWarning() << "BatchRenderQueue::process() job: " << queued.jobID << " timed out waiting to be ready.";
+        result.timedOut = true;
+      }
+
+      result.success = d->render(d->map, result.width, result.height, result.pixels);
+    }
+    catch(...)
+    {
+      tpWarning() << "Exception caught in BatchRenderQueue::process() job: " << queued.jobID;
+      result.success = false;
+    }
+
+    BatchRenderJob job = std::move(queued.job);
+    d->jobs.pop_front();
+
+    if(job.done)
+      job.done(result);
+
+    count++;
+  }
+
+  d->rendered += count;
+  d->renderSeconds += (d->clock()-startMS) / 1000.0;
+  return count;
+}
+
+//##################################################################################################
+size_t BatchRenderQueue::rendered() const
+{
+  return d->rendered;
+}
+
+//##################################################################################################
+double BatchRenderQueue::thumbnailsPerSecond() const
+{
+  return d->renderSeconds>0.0?double(d->rendered)/d->renderSeconds:0.0;
+}
+
+}
@@ -0,0 +1,49 @@
+#include "tp_maps_emcc/BuildVariant.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+BuildVariant buildVariant()
+{
+#if defined(TP_MAPS_EMCC_SIMD) && defined(TP_MAPS_EMCC_THREADS)
+  return BuildVariant::SIMDThreads;
+#elif defined(TP_MAPS_EMCC_SIMD)
+  return BuildVariant::SIMD;
+#else
+  return BuildVariant::Baseline;
+#endif
+}
+
+//##################################################################################################
+const char* buildVariantToString(BuildVariant buildVariant)
+{
+  switch(buildVariant)
+  {
+  case BuildVariant::Baseline:    return "baseline";
+  case BuildVariant::SIMD:        return "simd";
+  case BuildVariant::SIMDThreads: return "simd-threads";
+  }
+  return "baseline";
+}
+
+}
+
+#ifdef __EMSCRIPTEN__
+//##################################################################################################
+extern "C"
+{
+
+//##################################################################################################
+//! Lets the page confirm which variant the loader picked.
+EMSCRIPTEN_KEEPALIVE const char* tp_maps_emcc_build_variant()
+{
+  return tp_maps_emcc::buildVariantToString(tp_maps_emcc::buildVariant());
+}
+
+}
+#endif
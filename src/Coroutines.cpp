@@ -0,0 +1,77 @@
+#include "tp_maps_emcc/Coroutines.h"
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+struct CoroutineScheduler::Private
+{
+  CoroutineWaiter* head{nullptr};
+  CoroutineWaiter* tail{nullptr};
+  size_t suspended{0};
+};
+
+//##################################################################################################
+CoroutineScheduler::CoroutineScheduler():
+  d(new Private())
+{
+
+}
+
+//##################################################################################################
+CoroutineScheduler::~CoroutineScheduler()
+{
+  // The waiter lives in the coroutine frame and is gone once the frame is destroyed.
+  for(CoroutineWaiter* waiter=d->head; waiter;)
+  {
+    CoroutineWaiter* next = waiter->next;
+    if(waiter->destroy)
+      waiter->destroy(waiter);
+    waiter = next;
+  }
+
+  delete d;
+}
+
+//##################################################################################################
+void CoroutineScheduler::suspend(CoroutineWaiter* waiter)
+{
+  waiter->next = nullptr;
+  if(d->tail)
+    d->tail->next = waiter;
+  else
+    d->head = waiter;
+  d->tail = waiter;
+  d->suspended++;
+}
+
+//##################################################################################################
+void CoroutineScheduler::resume()
+{
+  // Detach the list so that coroutines suspending again while this runs are not polled twice.
+  CoroutineWaiter* waiter = d->head;
+  d->head = nullptr;
+  d->tail = nullptr;
+  d->suspended = 0;
+
+  while(waiter)
+  {
+    // The waiter lives in the coroutine frame and may be gone once it has been woken.
+    CoroutineWaiter* next = waiter->next;
+
+    if(waiter->poll(waiter))
+      waiter->wake(waiter);
+    else
+      suspend(waiter);
+
+    waiter = next;
+  }
+}
+
+//##################################################################################################
+size_t CoroutineScheduler::suspended() const
+{
+  return d->suspended;
+}
+
+}
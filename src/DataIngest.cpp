@@ -0,0 +1,190 @@
+#include "tp_maps_emcc/DataIngest.h"
+#include "tp_maps_emcc/MapManager.h"
+#include "tp_maps_emcc/Map.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <emscripten.h>
+
+#include <unordered_map>
+#include <memory>
+#include <utility>
+#include <new>
+
+namespace tp_maps_emcc
+{
+
+namespace
+{
+//##################################################################################################
+struct Buffer_lt
+{
+  std::unique_ptr<uint8_t[]> data;
+  size_t capacity{0};
+  size_t size{0};
+};
+
+//##################################################################################################
+struct Stream_lt
+{
+  Buffer_lt front;
+  Buffer_lt back;
+  size_t sequence{0};
+  bool deliveryQueued{false};
+  DataIngest::Consumer consumer;
+};
+}
+
+//##################################################################################################
+struct DataIngest::Private
+{
+  Deliver deliver;
+  std::unordered_map<std::string, Stream_lt> streams;
+
+  // Set to false on destruction so that queued deliveries become no-ops.
+  std::shared_ptr<bool> alive{std::make_shared<bool>(true)};
+
+  //################################################################################################
+  Private(const Deliver& deliver_):
+    deliver(deliver_)
+  {
+
+  }
+
+  //################################################################################################
+  void consume(const std::string& name)
+  {
+    auto i = streams.find(name);
+    if(i == streams.end())
+      return;
+
+    Stream_lt& stream = i->second;
+    stream.deliveryQueued = false;
+
+    if(stream.consumer && stream.front.data)
+    {
+      IngestBatch batch;
+      batch.data = stream.front.data.get();
+      batch.size = stream.front.size;
+      batch.sequence = stream.sequence;
+      stream.consumer(batch);
+    }
+  }
+};
+
+//##################################################################################################
+DataIngest::DataIngest(const Deliver& deliver):
+  d(new Private(deliver))
+{
+
+}
+
+//##################################################################################################
+DataIngest::~DataIngest()
+{
+  *d->alive = false;
+  delete d;
+}
+
+//##################################################################################################
+void DataIngest::setConsumer(const std::string& stream, const Consumer& consumer)
+{
+  d->streams[stream].consumer = consumer;
+}
+
+//##################################################################################################
+uint8_t* DataIngest::acquire(const std::string& stream, size_t size)
+{
+  Buffer_lt& back = d->streams[stream].back;
+  if(back.capacity < size)
+  {
+    back.data.reset();
+    back.data.reset(new (std::nothrow) uint8_t[size]);
+    back.capacity = back.data?size:0;
+    if(!back.data)
+    {
+      tpWarning() << "DataIngest::acquire() failed to allocate " << size << " bytes for: " << stream;
+      return nullptr;
+    }
+  }
+
+  return back.data.get();
+}
+
+//##################################################################################################
+bool DataIngest::commit(const std::string& stream, size_t size)
+{
+  auto i = d->streams.find(stream);
+  if(i == d->streams.end() || i->second.back.capacity < size)
+  {
+    tpWarning() << "DataIngest::commit() called without a large enough acquire for: " << stream;
+    return false;
+  }
+
+  Stream_lt& s = i->second;
+  s.back.size = size;
+  std::swap(s.front, s.back);
+  s.sequence++;
+
+  if(!s.deliveryQueued)
+  {
+    s.deliveryQueued = true;
+    d->deliver([dd=d, alive=d->alive, stream]
+    {
+      if(*alive)
+        dd->consume(stream);
+    });
+  }
+
+  return true;
+}
+
+//##################################################################################################
+void DataIngest::release(const std::string& stream)
+{
+  if(auto i = d->streams.find(stream); i != d->streams.end())
+  {
+    i->second.front = Buffer_lt();
+    i->second.back = Buffer_lt();
+  }
+}
+
+//##################################################################################################
+void DataIngest::clear()
+{
+  d->streams.clear();
+}
+
+//##################################################################################################
+size_t DataIngest::allocatedBytes() const
+{
+  size_t bytes=0;
+  for(const auto& i : d->streams)
+    bytes += i.second.front.capacity + i.second.back.capacity;
+  return bytes;
+}
+
+}
+
+//##################################################################################################
+extern "C"
+{
+
+//##################################################################################################
+//! handle is the value returned by MapManager::createMap.
+EMSCRIPTEN_KEEPALIVE uint8_t* tp_maps_emcc_ingest_acquire(void* handle, const char* stream, size_t size)
+{
+  if(!handle || !stream)
+    return nullptr;
+  return static_cast<tp_maps_emcc::MapDetails*>(handle)->map->dataIngest().acquire(stream, size);
+}
+
+//##################################################################################################
+EMSCRIPTEN_KEEPALIVE int tp_maps_emcc_ingest_commit(void* handle, const char* stream, size_t size)
+{
+  if(!handle || !stream)
+    return 0;
+  return static_cast<tp_maps_emcc::MapDetails*>(handle)->map->dataIngest().commit(stream, size)?1:0;
+}
+
+}
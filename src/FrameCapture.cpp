@@ -0,0 +1,284 @@
+#include "tp_maps_emcc/FrameCapture.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <emscripten.h>
+#include <GLES3/gl3.h>
+
+#include <array>
+
+namespace tp_maps_emcc
+{
+
+namespace
+{
+//##################################################################################################
+struct Slot_lt
+{
+  GLuint pbo{0};
+  GLsync sync{nullptr};
+  size_t allocated{0};
+  int width{0};
+  int height{0};
+  size_t frameIndex{0};
+  bool sequence{false};
+  std::vector<FrameCapture::Callback> callbacks;
+};
+}
+
+//##################################################################################################
+struct FrameCapture::Private
+{
+  bool webGL2;
+  Deliver deliver;
+
+  Callback sequenceCallback;
+  std::vector<Callback> pendingCallbacks;
+
+  // A ring of readback slots, tail is the oldest in flight and count the number in flight.
+  std::array<Slot_lt, 3> slots;
+  size_t tail{0};
+  size_t count{0};
+
+  std::vector<std::vector<uint8_t>> freeBuffers;
+
+  size_t frameIndex{0};
+  size_t droppedFrames{0};
+
+  //################################################################################################
+  Private(bool webGL2_, const Deliver& deliver_):
+    webGL2(webGL2_),
+    deliver(deliver_)
+  {
+
+  }
+
+  //################################################################################################
+  std::vector<uint8_t> takeBuffer(size_t size)
+  {
+    std::vector<uint8_t> buffer;
+    if(!freeBuffers.empty())
+    {
+      buffer.swap(freeBuffers.back());
+      freeBuffers.pop_back();
+    }
+    buffer.resize(size);
+    return buffer;
+  }
+
+  //################################################################################################
+  void recycle(std::vector<uint8_t>&& buffer)
+  {
+    if(freeBuffers.size() < slots.size()+1)
+      freeBuffers.push_back(std::move(buffer));
+  }
+
+  //################################################################################################
+  void deliverFrame(const std::shared_ptr<CapturedFrame>& frame, std::vector<Callback>&& callbacks, bool sequence)
+  {
+    deliver([this, frame, callbacks=std::move(callbacks), sequence]
+    {
+      for(const auto& callback : callbacks)
+        callback(*frame);
+
+      if(sequence && sequenceCallback)
+        sequenceCallback(*frame);
+
+      recycle(std::move(frame->pixels));
+    });
+  }
+
+  //################################################################################################
+  void readSync(int width, int height, std::vector<Callback>&& callbacks, bool sequence)
+  {
+    auto frame = std::make_shared<CapturedFrame>();
+    frame->width = width;
+    frame->height = height;
+    frame->frameIndex = frameIndex;
+    frame->pixels = takeBuffer(size_t(width)*size_t(height)*4);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame->pixels.data());
+
+    deliverFrame(frame, std::move(callbacks), sequence);
+  }
+
+  //################################################################################################
+  bool readAsync(int width, int height, std::vector<Callback>& callbacks, bool sequence)
+  {
+    if(count == slots.size())
+      return false;
+
+    Slot_lt& slot = slots[(tail+count) % slots.size()];
+    size_t size = size_t(width)*size_t(height)*4;
+
+    if(!slot.pbo)
+      glGenBuffers(1, &slot.pbo);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if(slot.allocated != size)
+    {
+      glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(size), nullptr, GL_STREAM_READ);
+      slot.allocated = size;
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.frameIndex = frameIndex;
+    slot.sequence = sequence;
+    slot.callbacks.swap(callbacks);
+    count++;
+    return true;
+  }
+
+  //################################################################################################
+  void releaseSlot(Slot_lt& slot)
+  {
+    if(slot.sync)
+      glDeleteSync(slot.sync);
+    slot.sync = nullptr;
+    slot.callbacks.clear();
+  }
+};
+
+//##################################################################################################
+FrameCapture::FrameCapture(bool webGL2, const Deliver& deliver):
+  d(new Private(webGL2, deliver))
+{
+
+}
+
+//##################################################################################################
+FrameCapture::~FrameCapture()
+{
+  clear();
+  delete d;
+}
+
+//##################################################################################################
+void FrameCapture::captureFrame(const Callback& callback)
+{
+  d->pendingCallbacks.push_back(callback);
+}
+
+//##################################################################################################
+void FrameCapture::startSequence(const Callback& callback)
+{
+  d->sequenceCallback = callback;
+}
+
+//##################################################################################################
+void FrameCapture::stopSequence()
+{
+  d->sequenceCallback = Callback();
+}
+
+//##################################################################################################
+bool FrameCapture::active() const
+{
+  return d->sequenceCallback || !d->pendingCallbacks.empty() || d->count>0;
+}
+
+//##################################################################################################
+bool FrameCapture::needsFrame() const
+{
+  if(!d->sequenceCallback && d->pendingCallbacks.empty())
+    return false;
+
+  return !d->webGL2 || d->count<d->slots.size();
+}
+
+//##################################################################################################
+size_t FrameCapture::droppedFrames() const
+{
+  return d->droppedFrames;
+}
+
+//##################################################################################################
+void FrameCapture::framePainted(int width, int height)
+{
+  bool sequence = bool(d->sequenceCallback);
+  if((!sequence && d->pendingCallbacks.empty()) || width<1 || height<1)
+    return;
+
+  d->frameIndex++;
+
+  if(!d->webGL2)
+  {
+    std::vector<Callback> callbacks;
+    callbacks.swap(d->pendingCallbacks);
+    d->readSync(width, height, std::move(callbacks), sequence);
+    return;
+  }
+
+  // If all slots are in flight keep the single shot requests for the next frame.
+  if(!d->readAsync(width, height, d->pendingCallbacks, sequence) && sequence)
+    d->droppedFrames++;
+}
+
+//##################################################################################################
+void FrameCapture::poll()
+{
+  while(d->count>0)
+  {
+    Slot_lt& slot = d->slots[d->tail];
+
+    GLenum status = glClientWaitSync(slot.sync, 0, 0);
+    if(status == GL_TIMEOUT_EXPIRED)
+      return;
+
+    d->tail = (d->tail+1) % d->slots.size();
+    d->count--;
+
+    if(status == GL_WAIT_FAILED)
+    {
+      tpWarning() << "FrameCapture::poll() glClientWaitSync failed, frame dropped.";
+      d->releaseSlot(slot);
+      continue;
+    }
+
+    auto frame = std::make_shared<CapturedFrame>();
+    frame->width = slot.width;
+    frame->height = slot.height;
+    frame->frameIndex = slot.frameIndex;
+    frame->pixels = d->takeBuffer(slot.allocated);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    EM_ASM({GLctx.getBufferSubData($0, 0, HEAPU8.subarray($1, $1+$2));},
+           GL_PIXEL_PACK_BUFFER, frame->pixels.data(), frame->pixels.size());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::vector<Callback> callbacks;
+    callbacks.swap(slot.callbacks);
+    d->deliverFrame(frame, std::move(callbacks), slot.sequence);
+    d->releaseSlot(slot);
+  }
+}
+
+//##################################################################################################
+void FrameCapture::clear()
+{
+  for(Slot_lt& slot : d->slots)
+  {
+    d->releaseSlot(slot);
+    if(slot.pbo)
+      glDeleteBuffers(1, &slot.pbo);
+    slot.pbo = 0;
+    slot.allocated = 0;
+  }
+
+  d->tail = 0;
+  d->count = 0;
+  d->pendingCallbacks.clear();
+  d->sequenceCallback = Callback();
+  d->droppedFrames = 0;
+}
+
+}
@@ -0,0 +1,262 @@
+#include "tp_maps_emcc/GLStateCache.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <emscripten.h>
+
+#include <cstdint>
+
+#ifndef TP_MAPS_EMCC_NO_GL_STATE_CACHE
+//##################################################################################################
+EM_JS(void, tp_maps_emcc_install_gl_state_cache, (int handle), {
+  var context = GL.getContext(handle);
+  if(!context || !context.GLctx || context.GLctx.__tpMapsEmccStateCache)
+    return;
+
+  var gl = context.GLctx;
+  var stats = {issued: 0, elided: 0};
+
+  // Undefined means unknown, so the first call for each piece of state is always issued. Multi
+  // value state is held in separate fields so that comparing it does not allocate.
+  var state = {
+    program: undefined,
+    buffers: {},
+    activeTexture: 0x84C0,
+    textures: [],
+    framebuffers: {},
+    renderbuffer: undefined,
+    vertexArray: undefined,
+    caps: {},
+    blendSrcRGB: undefined,
+    blendDstRGB: undefined,
+    blendSrcAlpha: undefined,
+    blendDstAlpha: undefined,
+    blendEquationRGB: undefined,
+    blendEquationAlpha: undefined,
+    depthFunc: undefined,
+    depthMask: undefined,
+    cullFace: undefined,
+    colorMaskR: undefined,
+    colorMaskG: undefined,
+    colorMaskB: undefined,
+    colorMaskA: undefined,
+    clearR: undefined,
+    clearG: undefined,
+    clearB: undefined,
+    clearA: undefined,
+    viewportX: undefined,
+    viewportY: undefined,
+    viewportW: undefined,
+    viewportH: undefined
+  };
+
+  gl.__tpMapsEmccStateCache = {stats: stats, state: state};
+
+  function wrap(name, isSame, update) {
+    var original = gl[name];
+    if(!original)
+      return;
+    gl[name] = function() {
+      if(isSame.apply(null, arguments)) {
+        stats.elided++;
+        return;
+      }
+      stats.issued++;
+      update.apply(null, arguments);
+      return original.apply(gl, arguments);
+    };
+  }
+
+  function onDelete(name, clear) {
+    var original = gl[name];
+    if(!original)
+      return;
+    gl[name] = function(object) {
+      if(object)
+        clear(object);
+      return original.apply(gl, arguments);
+    };
+  }
+
+  function clearValue(map, object) {
+    for(var key in map)
+      if(map[key] === object)
+        map[key] = null;
+  }
+
+  wrap("useProgram",
+       function(p) { return state.program === p; },
+       function(p) { state.program = p; });
+
+  wrap("bindBuffer",
+       function(t, b) { return state.buffers[t] === b; },
+       function(t, b) { state.buffers[t] = b; });
+
+  // Indexed binds also replace the generic binding for the target.
+  wrap("bindBufferBase",
+       function() { return false; },
+       function(t, i, b) { state.buffers[t] = b; });
+
+  wrap("bindBufferRange",
+       function() { return false; },
+       function(t, i, b) { state.buffers[t] = b; });
+
+  wrap("activeTexture",
+       function(u) { return state.activeTexture === u; },
+       function(u) { state.activeTexture = u; });
+
+  // Texture bindings are held per unit, indexed from TEXTURE0, and then by target.
+  function textureUnit() {
+    var i = state.activeTexture - 0x84C0;
+    return state.textures[i] || (state.textures[i] = {});
+  }
+
+  wrap("bindTexture",
+       function(t, tex) { return textureUnit()[t] === tex; },
+       function(t, tex) { textureUnit()[t] = tex; });
+
+  // FRAMEBUFFER binds both READ_FRAMEBUFFER and DRAW_FRAMEBUFFER.
+  wrap("bindFramebuffer",
+       function(t, fb) {
+         if(t === 0x8D40)
+           return state.framebuffers[0x8CA8] === fb && state.framebuffers[0x8CA9] === fb;
+         return state.framebuffers[t] === fb;
+       },
+       function(t, fb) {
+         if(t === 0x8D40) {
+           state.framebuffers[0x8CA8] = fb;
+           state.framebuffers[0x8CA9] = fb;
+         }
+         else
+           state.framebuffers[t] = fb;
+       });
+
+  wrap("bindRenderbuffer",
+       function(t, rb) { return state.renderbuffer === rb; },
+       function(t, rb) { state.renderbuffer = rb; });
+
+  // The element array binding belongs to the vertex array.
+  wrap("bindVertexArray",
+       function(vao) { return state.vertexArray === vao; },
+       function(vao) { state.vertexArray = vao; state.buffers[0x8893] = undefined; });
+
+  wrap("enable",
+       function(cap) { return state.caps[cap] === true; },
+       function(cap) { state.caps[cap] = true; });
+
+  wrap("disable",
+       function(cap) { return state.caps[cap] === false; },
+       function(cap) { state.caps[cap] = false; });
+
+  function isBlend(sc, dc, sa, da) {
+    return state.blendSrcRGB === sc && state.blendDstRGB === dc && state.blendSrcAlpha === sa && state.blendDstAlpha === da;
+  }
+
+  function setBlend(sc, dc, sa, da) {
+    state.blendSrcRGB = sc;
+    state.blendDstRGB = dc;
+    state.blendSrcAlpha = sa;
+    state.blendDstAlpha = da;
+  }
+
+  wrap("blendFunc",
+       function(s, d) { return isBlend(s, d, s, d); },
+       function(s, d) { setBlend(s, d, s, d); });
+
+  wrap("blendFuncSeparate", isBlend, setBlend);
+
+  wrap("blendEquation",
+       function(m) { return state.blendEquationRGB === m && state.blendEquationAlpha === m; },
+       function(m) { state.blendEquationRGB = m; state.blendEquationAlpha = m; });
+
+  wrap("blendEquationSeparate",
+       function(c, a) { return state.blendEquationRGB === c && state.blendEquationAlpha === a; },
+       function(c, a) { state.blendEquationRGB = c; state.blendEquationAlpha = a; });
+
+  wrap("depthFunc",
+       function(f) { return state.depthFunc === f; },
+       function(f) { state.depthFunc = f; });
+
+  wrap("depthMask",
+       function(m) { return state.depthMask === !!m; },
+       function(m) { state.depthMask = !!m; });
+
+  wrap("cullFace",
+       function(m) { return state.cullFace === m; },
+       function(m) { state.cullFace = m; });
+
+  wrap("colorMask",
+       function(r, g, b, a) {
+         return state.colorMaskR === !!r && state.colorMaskG === !!g && state.colorMaskB === !!b && state.colorMaskA === !!a;
+       },
+       function(r, g, b, a) {
+         state.colorMaskR = !!r;
+         state.colorMaskG = !!g;
+         state.colorMaskB = !!b;
+         state.colorMaskA = !!a;
+       });
+
+  wrap("clearColor",
+       function(r, g, b, a) { return state.clearR === r && state.clearG === g && state.clearB === b && state.clearA === a; },
+       function(r, g, b, a) { state.clearR = r; state.clearG = g; state.clearB = b; state.clearA = a; });
+
+  wrap("viewport",
+       function(x, y, w, h) { return state.viewportX === x && state.viewportY === y && state.viewportW === w && state.viewportH === h; },
+       function(x, y, w, h) { state.viewportX = x; state.viewportY = y; state.viewportW = w; state.viewportH = h; });
+
+  // Deleting a bound object reverts the binding to null.
+  onDelete("deleteBuffer", function(o) { clearValue(state.buffers, o); });
+  onDelete("deleteTexture", function(o) { state.textures.forEach(function(unit) { clearValue(unit, o); }); });
+  onDelete("deleteFramebuffer", function(o) { clearValue(state.framebuffers, o); });
+  onDelete("deleteRenderbuffer", function(o) { if(state.renderbuffer === o) state.renderbuffer = null; });
+  onDelete("deleteVertexArray", function(o) {
+    if(state.vertexArray === o) {
+      state.vertexArray = null;
+      state.buffers[0x8893] = undefined;
+    }
+  });
+});
+
+//##################################################################################################
+EM_JS(void, tp_maps_emcc_gl_state_cache_stats, (int handle, uint32_t* out, int reset), {
+  var context = GL.getContext(handle);
+  var cache = context && context.GLctx && context.GLctx.__tpMapsEmccStateCache;
+  HEAPU32[out>>2] = cache ? cache.stats.issued : 0;
+  HEAPU32[(out>>2)+1] = cache ? cache.stats.elided : 0;
+  if(cache && reset) {
+    cache.stats.issued = 0;
+    cache.stats.elided = 0;
+  }
+});
+#endif
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+void installGLStateCache(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+#ifndef TP_MAPS_EMCC_NO_GL_STATE_CACHE
+  tp_maps_emcc_install_gl_state_cache(int(context));
+#else
+  TP_UNUSED(context);
+#endif
+}
+
+//##################################################################################################
+void glStateCacheStats(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, GLCallStats& stats, bool reset)
+{
+#ifndef TP_MAPS_EMCC_NO_GL_STATE_CACHE
+  uint32_t counts[2]{0, 0};
+  tp_maps_emcc_gl_state_cache_stats(int(context), counts, reset?1:0);
+  stats.issued = counts[0];
+  stats.elided = counts[1];
+#else
+  TP_UNUSED(context);
+  TP_UNUSED(reset);
+  stats.issued = 0;
+  stats.elided = 0;
+#endif
+}
+
+}
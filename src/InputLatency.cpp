@@ -0,0 +1,82 @@
+#include "tp_maps_emcc/InputLatency.h"
+
+#include <cmath>
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+std::string inputEventTypeToString(InputEventType type)
+{
+  switch(type)
+  {
+  case InputEventType::Mouse: return "Mouse";
+  case InputEventType::Wheel: return "Wheel";
+  case InputEventType::Touch: return "Touch";
+  }
+  return "Mouse";
+}
+
+//##################################################################################################
+double InputLatencyStats::meanMS() const
+{
+  return count>0?totalMS/double(count):0.0;
+}
+
+//##################################################################################################
+double InputLatencyStats::bucketLowerMS(size_t bucket)
+{
+  return bucket==0?0.0:std::ldexp(1.0, int(bucket)-1);
+}
+
+//##################################################################################################
+void InputLatencyStats::addSample(InputEventType type, double latencyMS)
+{
+  size_t bucket=0;
+  while(bucket+1<bucketCount && latencyMS>=bucketLowerMS(bucket+1))
+    bucket++;
+
+  histogram[bucket]++;
+  count++;
+  totalMS += latencyMS;
+
+  if(latencyMS>maxMS || count==1)
+  {
+    maxMS = latencyMS;
+    worstEventType = type;
+  }
+
+  double& typeMax = maxMSByType.at(size_t(type));
+  if(latencyMS>typeMax)
+    typeMax = latencyMS;
+}
+
+//##################################################################################################
+void InputLatencyTracker::eventReceived(InputEventType type, double timeMS)
+{
+  if(m_pendingCount<m_pending.size())
+    m_pending[m_pendingCount++] = {type, timeMS};
+}
+
+//##################################################################################################
+void InputLatencyTracker::paintFinished(double timeMS)
+{
+  for(size_t i=0; i<m_pendingCount; i++)
+    m_stats.addSample(m_pending[i].type, timeMS - m_pending[i].timeMS);
+  m_pendingCount = 0;
+}
+
+//##################################################################################################
+const InputLatencyStats& InputLatencyTracker::stats() const
+{
+  return m_stats;
+}
+
+//##################################################################################################
+void InputLatencyTracker::reset()
+{
+  m_pendingCount = 0;
+  m_stats = InputLatencyStats();
+}
+
+}
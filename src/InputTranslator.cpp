@@ -0,0 +1,310 @@
+#include "tp_maps_emcc/InputTranslator.h"
+
+#include "tp_utils/DebugUtils.h"
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+struct InputTranslator::Private
+{
+  std::function<void(const tp_maps::MouseEvent&)> mouseEvent;
+
+  float pixelScale{1.0f};
+
+  glm::ivec2 mousePos{0,0};
+
+  bool isDownLeftButton {false};
+  bool isDownRightButton{false};
+
+  enum class TouchMode_lt
+  {
+    New,
+    Pan,
+    ZoomRotate,
+    Invalid
+  };
+
+  TouchMode_lt touchMode{TouchMode_lt::New};
+  glm::ivec2 touchStartPos{0,0};
+
+  glm::vec2 zoomRotateAPos{0.0f,0.0f};
+  glm::vec2 zoomRotateBPos{0.0f,0.0f};
+  float zoomRotateDist{0.0f};
+
+  int64_t firstPress{0};
+  int64_t secondPress{0};
+
+  //################################################################################################
+  Private(const std::function<void(const tp_maps::MouseEvent&)>& mouseEvent_):
+    mouseEvent(mouseEvent_)
+  {
+
+  }
+
+  //################################################################################################
+  void invalidateDoubleTap()
+  {
+    firstPress  = 0;
+    secondPress = 0;
+  }
+
+  //################################################################################################
+  template<typename T>
+  glm::ivec2 scaleMouseCoord(T x, T y)
+  {
+    return {int(float(x) * pixelScale + 0.5f), int(float(y) * pixelScale + 0.5f)};
+  }
+
+  //################################################################################################
+  void emit(tp_maps::MouseEventType type,
+            const glm::ivec2& pos,
+            tp_maps::Button button,
+            tp_maps::KeyboardModifier modifiers)
+  {
+    tp_maps::MouseEvent e(type);
+    e.pos = pos;
+    e.button = button;
+    e.modifiers = modifiers;
+    mouseEvent(e);
+  }
+
+  //################################################################################################
+  //0 : Left button
+  //1 : Middle button (if present)
+  //2 : Right button
+  static tp_maps::Button button(int button)
+  {
+    switch(button)
+    {
+    case 0:  return tp_maps::Button::LeftButton;
+    case 2:  return tp_maps::Button::RightButton;
+    default: return tp_maps::Button::NoButton;
+    }
+  }
+};
+
+//##################################################################################################
+InputTranslator::InputTranslator(const std::function<void(const tp_maps::MouseEvent&)>& mouseEvent):
+  d(new Private(mouseEvent))
+{
+
+}
+
+//##################################################################################################
+InputTranslator::~InputTranslator()
+{
+  delete d;
+}
+
+//##################################################################################################
+void InputTranslator::setPixelScale(float pixelScale)
+{
+  d->pixelScale = pixelScale;
+}
+
+//##################################################################################################
+float InputTranslator::pixelScale() const
+{
+  return d->pixelScale;
+}
+
+//##################################################################################################
+const glm::ivec2& InputTranslator::mousePos() const
+{
+  return d->mousePos;
+}
+
+//##################################################################################################
+void InputTranslator::mouseInput(const MouseInput& input)
+{
+  switch(input.type)
+  {
+  case MouseInputType::Down: //---------------------------------------------------------------------
+  {
+    d->mousePos = d->scaleMouseCoord(input.targetX, input.targetY);
+    tp_maps::Button button = Private::button(input.button);
+    if(button == tp_maps::Button::LeftButton)  d->isDownLeftButton  = true;
+    if(button == tp_maps::Button::RightButton) d->isDownRightButton = true;
+    d->emit(tp_maps::MouseEventType::Press, d->mousePos, button, input.modifiers);
+    break;
+  }
+  case MouseInputType::Up: //-----------------------------------------------------------------------
+  {
+    d->mousePos = d->scaleMouseCoord(input.targetX, input.targetY);
+    tp_maps::Button button = Private::button(input.button);
+    if(button == tp_maps::Button::LeftButton)  d->isDownLeftButton  = false;
+    if(button == tp_maps::Button::RightButton) d->isDownRightButton = false;
+    d->emit(tp_maps::MouseEventType::Release, d->mousePos, button, input.modifiers);
+    break;
+  }
+  case MouseInputType::DoubleClick: //--------------------------------------------------------------
+  {
+    d->emit(tp_maps::MouseEventType::DoubleClick, d->mousePos, Private::button(input.button), input.modifiers);
+    break;
+  }
+  case MouseInputType::Move: //---------------------------------------------------------------------
+  {
+    if(input.pointerLocked)
+      d->mousePos += d->scaleMouseCoord(tpBound(-10, input.movementX, 10),
+                                        tpBound(-10, input.movementY, 10));
+    else
+      d->mousePos = d->scaleMouseCoord(input.targetX, input.targetY);
+
+    d->emit(tp_maps::MouseEventType::Move, d->mousePos, tp_maps::Button::NoButton, input.modifiers);
+    break;
+  }
+  case MouseInputType::Leave: //--------------------------------------------------------------------
+  {
+    d->mousePos = d->scaleMouseCoord(input.targetX, input.targetY);
+
+    if(d->isDownLeftButton)
+    {
+      d->isDownLeftButton = false;
+      d->emit(tp_maps::MouseEventType::Release, d->mousePos, tp_maps::Button::LeftButton, input.modifiers);
+    }
+
+    if(d->isDownRightButton)
+    {
+      d->isDownRightButton = false;
+      d->emit(tp_maps::MouseEventType::Release, d->mousePos, tp_maps::Button::RightButton, input.modifiers);
+    }
+    break;
+  }
+  }
+}
+
+//##################################################################################################
+void InputTranslator::wheelInput(const WheelInput& input)
+{
+  tp_maps::MouseEvent e(tp_maps::MouseEventType::Wheel);
+  e.pos = d->mousePos;
+  e.delta = -input.deltaY;
+  e.modifiers = input.modifiers;
+  d->mouseEvent(e);
+}
+
+//##################################################################################################
+void InputTranslator::touchInput(const TouchInput& input)
+{
+  using TouchMode_lt = Private::TouchMode_lt;
+
+  switch(input.type)
+  {
+  case TouchInputType::Start: //--------------------------------------------------------------------
+  {
+    if(input.numTouches == 1)
+    {
+      d->touchMode = TouchMode_lt::New;
+      d->mousePos = d->scaleMouseCoord(input.touches[0].targetX, input.touches[0].targetY);
+      d->touchStartPos = d->mousePos;
+
+      d->firstPress = d->secondPress;
+      d->secondPress = input.timeMS;
+    }
+    else if(input.numTouches == 2)
+    {
+      if(d->touchMode == TouchMode_lt::Pan)
+        d->emit(tp_maps::MouseEventType::Release, d->mousePos, tp_maps::Button::LeftButton, input.modifiers);
+
+      d->touchMode = TouchMode_lt::ZoomRotate;
+      d->invalidateDoubleTap();
+
+      d->zoomRotateAPos = glm::vec2(input.touches[0].targetX, input.touches[0].targetY);
+      d->zoomRotateBPos = glm::vec2(input.touches[1].targetX, input.touches[1].targetY);
+      d->zoomRotateDist = glm::length(d->zoomRotateAPos - d->zoomRotateBPos);
+
+      glm::vec2 m = d->zoomRotateBPos + ((d->zoomRotateAPos-d->zoomRotateBPos) / 2.0f);
+      d->mousePos = d->scaleMouseCoord(m.x, m.y);
+    }
+    else
+    {
+      d->touchMode = TouchMode_lt::Invalid;
+      d->invalidateDoubleTap();
+    }
+
+    break;
+  }
+  case TouchInputType::End: //----------------------------------------------------------------------
+  {
+    if(input.numTouches != 1)
+      break;
+
+    if(d->touchMode == TouchMode_lt::Pan)
+    {
+      d->mousePos = d->scaleMouseCoord(input.touches[0].targetX, input.touches[0].targetY);
+      d->emit(tp_maps::MouseEventType::Release, d->mousePos, tp_maps::Button::LeftButton, input.modifiers);
+    }
+    else if((input.timeMS - d->firstPress) < 400)
+    {
+      d->emit(tp_maps::MouseEventType::DoubleClick, d->mousePos, tp_maps::Button::LeftButton, input.modifiers);
+    }
+    else if(d->touchMode == TouchMode_lt::New && (input.timeMS - d->secondPress) < 400)
+    {
+      d->emit(tp_maps::MouseEventType::Press, d->touchStartPos, tp_maps::Button::LeftButton, input.modifiers);
+      d->mousePos = d->scaleMouseCoord(input.touches[0].targetX, input.touches[0].targetY);
+      d->emit(tp_maps::MouseEventType::Release, d->mousePos, tp_maps::Button::LeftButton, input.modifiers);
+    }
+
+    break;
+  }
+  case TouchInputType::Move: //---------------------------------------------------------------------
+  {
+    if(input.numTouches == 1)
+    {
+      if(d->touchMode == TouchMode_lt::Pan || d->touchMode == TouchMode_lt::New)
+      {
+        d->mousePos = d->scaleMouseCoord(input.touches[0].targetX, input.touches[0].targetY);
+
+        if(d->touchMode == TouchMode_lt::Pan)
+        {
+          d->emit(tp_maps::MouseEventType::Move, d->mousePos, tp_maps::Button::NoButton, input.modifiers);
+        }
+        else
+        {
+          int ox = std::abs(d->touchStartPos.x - d->mousePos.x);
+          int oy = std::abs(d->touchStartPos.y - d->mousePos.y);
+          if((ox+oy) > 10)
+          {
+            d->touchMode = TouchMode_lt::Pan;
+            d->emit(tp_maps::MouseEventType::Press, d->touchStartPos, tp_maps::Button::LeftButton, input.modifiers);
+            d->invalidateDoubleTap();
+          }
+        }
+      }
+    }
+    else if(input.numTouches == 2)
+    {
+      if(d->touchMode == TouchMode_lt::New)
+        d->touchMode = TouchMode_lt::ZoomRotate;
+
+      if(d->touchMode == TouchMode_lt::ZoomRotate)
+      {
+        glm::vec2 zoomRotateAPos = glm::vec2(input.touches[0].targetX, input.touches[0].targetY);
+        glm::vec2 zoomRotateBPos = glm::vec2(input.touches[1].targetX, input.touches[1].targetY);
+        float zoomRotateDist = glm::length(zoomRotateAPos - zoomRotateBPos);
+
+        tp_maps::MouseEvent e(tp_maps::MouseEventType::Wheel);
+        e.modifiers = input.modifiers;
+        e.delta = (zoomRotateDist - d->zoomRotateDist) * 5.0f;
+        if(std::abs(e.delta)>1)
+        {
+          e.pos = d->mousePos;
+          d->mouseEvent(e);
+
+          d->zoomRotateAPos = zoomRotateAPos;
+          d->zoomRotateBPos = zoomRotateBPos;
+          d->zoomRotateDist = zoomRotateDist;
+        }
+      }
+    }
+    break;
+  }
+  case TouchInputType::Cancel: //-------------------------------------------------------------------
+  {
+    break;
+  }
+  }
+}
+
+}
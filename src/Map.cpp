@@ -1,12 +1,45 @@
 ﻿#include "tp_maps_emcc/Map.h"
+#include "tp_maps_emcc/FrameCapture.h"
+#include "tp_maps_emcc/InputTranslator.h"
+#include "tp_maps_emcc/InputLatency.h"
+#include "tp_maps_emcc/DataIngest.h"
+#include "tp_maps_emcc/GLStateCache.h"
+#include "tp_maps_emcc/MemoryAccounting.h"
+#include "tp_maps_emcc/Trace.h"
 
 #include "tp_maps/MouseEvent.h"
+#include "tp_maps/Layer.h"
 
 #include "tp_utils/DebugUtils.h"
 #include "tp_utils/TimeUtils.h"
 
 #include <emscripten.h>
 #include <emscripten/html5.h>
+#include <GLES3/gl3.h>
+
+#include <array>
+#include <algorithm>
+
+//##################################################################################################
+EM_JS(int, tp_maps_emcc_rebind_canvas, (int handle, const char* canvasID, int replaceCanvas), {
+  var context = GL.getContext(handle);
+  var target = document.querySelector(UTF8ToString(canvasID));
+  if(!context || !context.GLctx || !target)
+    return 0;
+
+  var canvas = context.GLctx.canvas;
+  if(canvas === target)
+    return 1;
+
+  if(!replaceCanvas)
+    return 0;
+
+  canvas.id = target.id;
+  canvas.className = target.className;
+  canvas.style.cssText = target.style.cssText;
+  target.replaceWith(canvas);
+  return 1;
+});
 
 namespace tp_maps_emcc
 {
@@ -19,41 +52,49 @@ struct Map::Private
   EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context{0};
   std::string canvasID;
 
-  float pixelScale{1.0f};
-
-  glm::ivec2 mousePos{0,0};
   bool pointerLock{false};
   bool usePointerLock{false};
 
   bool updateRequested{true};
+  size_t frameCount{0};
 
-  bool isDownLeftButton {false};
-  bool isDownRightButton{false};
-
-  enum class TouchMode_lt
-  {
-    New,
-    Pan,
-    ZoomRotate,
-    Invalid
-  };
-
-  TouchMode_lt touchMode{TouchMode_lt::New};
-  glm::ivec2 touchStartPos{0,0};
-
-  glm::vec2 zoomRotateAPos{0.0f,0.0f};
-  glm::vec2 zoomRotateBPos{0.0f,0.0f};
-  float zoomRotateDist{0.0f};
+  size_t makeCurrentIssued{0};
+  size_t makeCurrentElided{0};
 
-  int64_t firstPress{0};
-  int64_t secondPress{0};
+  InputTranslator input;
+  InputLatencyTracker inputLatency;
 
   std::vector<std::function<void()>> asyncCallbacks;
 
+  DataIngest dataIngest;
+
+  std::unique_ptr<FrameCapture> frameCapture;
+
+  // Progressive rendering paints at reduced resolution while the view is changing and at full
+  // resolution once it has settled for refineDelayMS. Levels resize the drawing buffer and tp_maps,
+  // so that its render targets shrink too, while the CSS size stays the same. The level is held for
+  // as long as the view keeps changing to avoid reallocating render targets on every paint.
+  static constexpr size_t levelCount{3};
+  static constexpr size_t fullLevel{levelCount-1};
+  static constexpr std::array<float, levelCount> levelScales{0.25f, 0.5f, 1.0f};
+  static constexpr double refineDelayMS{150.0};
+  std::array<double, levelCount> levelCostMS{};
+  size_t level{fullLevel};
+  double lastUpdateMS{0.0};
+  bool progressive{false};
+  double frameBudgetMS{16.0};
+  bool applyingLevel{false};
+
+  float devicePixelScale{1.0f};
+  double cssWidth{0.0};
+  double cssHeight{0.0};
+
   //################################################################################################
   Private(Map* q_, std::string canvasID_):
     q(q_),
-    canvasID(canvasID_)
+    canvasID(canvasID_),
+    input([q_](const tp_maps::MouseEvent& e){q_->mouseEvent(e);}),
+    dataIngest([q_](const std::function<void()>& callback){q_->callAsync(callback);})
   {
 
   }
@@ -104,170 +145,119 @@ struct Map::Private
 
 
   //################################################################################################
-  void update()
+  void update(size_t newLevel)
   {
+    // A level change is timed with the paint so that reallocating render targets counts too.
+    double start = emscripten_get_now();
+    if(newLevel != level)
+    {
+      TraceScope trace("setLevel", canvasID.c_str(), int64_t(newLevel));
+      level = newLevel;
+      applyResolution();
+    }
+
     q->paintGL();
+    levelCostMS[level] = emscripten_get_now() - start;
+
+    // Only capture converged frames.
+    if(frameCapture && level==fullLevel)
+      frameCapture->framePainted(q->width(), q->height());
   }
 
   //################################################################################################
-  void invalidateDoubleTap()
+  //! The finest level that is expected to paint within the budget, unmeasured levels are tried.
+  size_t interactiveLevel() const
   {
-    firstPress  = 0;
-    secondPress = 0;
+    for(size_t l=fullLevel; l>0; l--)
+      if(levelCostMS[l]<=frameBudgetMS)
+        return l;
+    return 0;
   }
 
   //################################################################################################
-  template<typename T>
-  glm::ivec2 scaleMouseCoord(T x, T y)
+  //! Size the drawing buffer and tp_maps for the current level, the browser scales it to the CSS size.
+  void applyResolution()
   {
-    return {int(float(x) * pixelScale + 0.5f), int(float(y) * pixelScale + 0.5f)};
+    float scale = devicePixelScale * levelScales[level];
+    int w = std::max(1, int(float(cssWidth)  * scale + 0.5f));
+    int h = std::max(1, int(float(cssHeight) * scale + 0.5f));
+
+    input.setPixelScale(scale);
+
+    emscripten_set_canvas_element_size(canvasID.data(), w, h);
+    emscripten_set_element_css_size(canvasID.data(), cssWidth, cssHeight);
+
+    applyingLevel = true;
+    q->resizeGL(w, h);
+    applyingLevel = false;
   }
 
   //################################################################################################
-  static EM_BOOL mouseCallback(int eventType, const EmscriptenMouseEvent* event, void *userData)
+  //! Pass an event to the translator, only events that request an update are timed.
+  /*!
+  Events are timed from their DOM timeStamp, which shares the emscripten_get_now() clock, so that
+  time spent queued behind a long frame is included.
+  */
+  template<typename T>
+  void translate(InputEventType type, double eventTimeMS, const T& closure)
   {
-    Private* d = static_cast<Private*>(userData);
+    double timeMS = eventTimeMS>0.0?eventTimeMS:emscripten_get_now();
+
+    bool wasRequested = updateRequested;
+    updateRequested = false;
+    closure();
 
+    if(updateRequested)
+      inputLatency.eventReceived(type, timeMS);
+    updateRequested = updateRequested || wasRequested;
+  }
+
+  //################################################################################################
+  template<typename T>
+  static tp_maps::KeyboardModifier modifiers(const T* event)
+  {
     tp_maps::KeyboardModifier modifiers {tp_maps::KeyboardModifier::None};
     if(event->shiftKey) modifiers = modifiers | tp_maps::KeyboardModifier::Shift;
     if(event-> ctrlKey) modifiers = modifiers | tp_maps::KeyboardModifier::Control;
     if(event->  altKey) modifiers = modifiers | tp_maps::KeyboardModifier::Alt;
+    return modifiers;
+  }
 
-    switch(eventType)
-    {
-    case EMSCRIPTEN_EVENT_CLICK: //-----------------------------------------------------------------
-    {
-      break;
-    }
-    case EMSCRIPTEN_EVENT_MOUSEDOWN: //-------------------------------------------------------------
-    {
-      tp_maps::MouseEvent e(tp_maps::MouseEventType::Press);
-      d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
-      e.pos = d->mousePos;
-      e.modifiers = modifiers;
-
-      if(d->usePointerLock)
-      {
-        emscripten_request_pointerlock(d->canvasID.data(), false);
-        d->pointerLock = true;
-      }
-      //0 : Left button
-      //1 : Middle button (if present)
-      //2 : Right button
-      switch (event->button)
-      {
-      case 0:  e.button = tp_maps::Button::LeftButton;  d->isDownLeftButton  = true; break;
-      case 2:  e.button = tp_maps::Button::RightButton; d->isDownRightButton = true; break;
-      default: e.button = tp_maps::Button::NoButton; break;
-      }
-      d->q->mouseEvent(e);
-      break;
-    }
-    case EMSCRIPTEN_EVENT_MOUSEUP: //---------------------------------------------------------------
-    {
-      tp_maps::MouseEvent e(tp_maps::MouseEventType::Release);
-      d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
-      e.pos = d->mousePos;
-      e.modifiers = modifiers;
-
-      if(d->usePointerLock)
-      {
-        emscripten_exit_pointerlock();
-        d->pointerLock = false;
-      }
+  //################################################################################################
+  void requestPointerLock()
+  {
+    EM_ASM({
+             var canvas = document.querySelector(UTF8ToString($0));
+             if(canvas && canvas.requestPointerLock)
+               canvas.requestPointerLock();
+           }, canvasID.c_str());
+  }
 
-      //0 : Left button
-      //1 : Middle button (if present)
-      //2 : Right button
-      switch (event->button)
-      {
-      case 0:  e.button = tp_maps::Button::LeftButton;  d->isDownLeftButton  = false;  break;
-      case 2:  e.button = tp_maps::Button::RightButton; d->isDownRightButton = false;  break;
-      default: e.button = tp_maps::Button::NoButton; break;
-      }
-      d->q->mouseEvent(e);
-      break;
-    }
-    case EMSCRIPTEN_EVENT_DBLCLICK: //--------------------------------------------------------------
-    {
-      tp_maps::MouseEvent e(tp_maps::MouseEventType::DoubleClick);
-      //d->mousePos = glm::ivec2(event->targetX, event->targetY);
-      e.pos = d->mousePos;
-      e.modifiers = modifiers;
-
-      //0 : Left button
-      //1 : Middle button (if present)
-      //2 : Right button
-      switch (event->button)
-      {
-      case 0:  e.button = tp_maps::Button::LeftButton;  break;
-      case 2:  e.button = tp_maps::Button::RightButton; break;
-      default: e.button = tp_maps::Button::NoButton;    break;
-      }
-      d->q->mouseEvent(e);
-      break;
-    }
-    case EMSCRIPTEN_EVENT_MOUSEMOVE: //-------------------------------------------------------------
-    {
-      tp_maps::MouseEvent e(tp_maps::MouseEventType::Move);
-      e.modifiers = modifiers;
+  //################################################################################################
+  static EM_BOOL mouseCallback(int eventType, const EmscriptenMouseEvent* event, void *userData)
+  {
+    Private* d = static_cast<Private*>(userData);
 
-      if(d->pointerLock)
-      {
-        EmscriptenPointerlockChangeEvent pointerlockStatus;
-        if(emscripten_get_pointerlock_status(&pointerlockStatus)==EMSCRIPTEN_RESULT_SUCCESS &&
-           pointerlockStatus.isActive == EM_TRUE)
-        {
-          d->mousePos += d->scaleMouseCoord(tpBound(-10, int(event->movementX), 10),
-                                            tpBound(-10, int(event->movementY), 10));
-        }
-      }
-      else
-        d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
+    MouseInput input;
+    input.button = event->button;
+    input.targetX = event->targetX;
+    input.targetY = event->targetY;
+    input.movementX = int(event->movementX);
+    input.movementY = int(event->movementY);
+    input.modifiers = modifiers(event);
+    input.eventTimeMS = event->timestamp;
 
-      e.pos = d->mousePos;
-      d->q->mouseEvent(e);
-      break;
-    }
-    case EMSCRIPTEN_EVENT_MOUSEENTER: //------------------------------------------------------------
-    {
-      break;
-    }
-    case EMSCRIPTEN_EVENT_MOUSELEAVE: //------------------------------------------------------------
+    switch(eventType)
     {
-      tp_maps::MouseEvent e(tp_maps::MouseEventType::Release);
-      d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
-      e.pos = d->mousePos;
-      e.modifiers = modifiers;
-
-      if(d->usePointerLock)
-      {
-        emscripten_exit_pointerlock();
-        d->pointerLock = false;
-      }
-
-      if(d->isDownLeftButton  == true)
-      {
-        d->isDownLeftButton = false;
-        e.button = tp_maps::Button::LeftButton;
-        d->q->mouseEvent(e);
-      }
-
-      if(d->isDownRightButton == true)
-      {
-        d->isDownRightButton = false;
-        e.button = tp_maps::Button::RightButton;
-        d->q->mouseEvent(e);
-      }
-
-      break;
+    case EMSCRIPTEN_EVENT_MOUSEDOWN:  input.type = MouseInputType::Down;        break;
+    case EMSCRIPTEN_EVENT_MOUSEUP:    input.type = MouseInputType::Up;          break;
+    case EMSCRIPTEN_EVENT_DBLCLICK:   input.type = MouseInputType::DoubleClick; break;
+    case EMSCRIPTEN_EVENT_MOUSEMOVE:  input.type = MouseInputType::Move;        break;
+    case EMSCRIPTEN_EVENT_MOUSELEAVE: input.type = MouseInputType::Leave;       break;
+    default: return EM_TRUE;
     }
 
-    default: //-------------------------------------------------------------------------------------
-    {
-      break;
-    }
-    }
+    d->q->mouseInput(input);
     return EM_TRUE;
   }
 
@@ -276,27 +266,14 @@ struct Map::Private
   {
     Private* d = static_cast<Private*>(userData);
 
-    tp_maps::KeyboardModifier modifiers {tp_maps::KeyboardModifier::None};
-    // if(event->shiftKey) modifiers = modifiers | tp_maps::KeyboardModifier::Shift;
-    // if(event-> ctrlKey) modifiers = modifiers | tp_maps::KeyboardModifier::Control;
-    // if(event->  altKey) modifiers = modifiers | tp_maps::KeyboardModifier::Alt;
-
-    switch(eventType)
-    {
-    case EMSCRIPTEN_EVENT_WHEEL: //-----------------------------------------------------------------
-    {
-      tp_maps::MouseEvent e(tp_maps::MouseEventType::Wheel);
-      e.pos = d->mousePos;
-      e.delta = -event->deltaY;
-      e.modifiers = modifiers;
-      d->q->mouseEvent(e);
-      break;
-    }
-    default:
+    if(eventType == EMSCRIPTEN_EVENT_WHEEL)
     {
-      break;
-    }
+      WheelInput input;
+      input.deltaY = event->deltaY;
+      input.eventTimeMS = event->mouse.timestamp;
+      d->q->wheelInput(input);
     }
+
     return EM_TRUE;
   }
 
@@ -305,181 +282,86 @@ struct Map::Private
   {
     Private* d = static_cast<Private*>(userData);
 
-    tp_maps::KeyboardModifier modifiers {tp_maps::KeyboardModifier::None};
-    if(touchEvent->shiftKey) modifiers = modifiers | tp_maps::KeyboardModifier::Shift;
-    if(touchEvent-> ctrlKey) modifiers = modifiers | tp_maps::KeyboardModifier::Control;
-    if(touchEvent->  altKey) modifiers = modifiers | tp_maps::KeyboardModifier::Alt;
+    TouchInput input;
+    input.numTouches = touchEvent->numTouches;
+    for(int i=0; i<2 && i<touchEvent->numTouches; i++)
+    {
+      input.touches[i].targetX = touchEvent->touches[i].targetX;
+      input.touches[i].targetY = touchEvent->touches[i].targetY;
+    }
+    input.timeMS = tp_utils::currentTimeMS();
+    input.modifiers = modifiers(touchEvent);
+    input.eventTimeMS = touchEvent->timestamp;
 
     switch(eventType)
     {
-    case EMSCRIPTEN_EVENT_TOUCHSTART: //------------------------------------------------------------
-    {
-      if(touchEvent->numTouches == 1)
-      {
-        d->touchMode = TouchMode_lt::New;
-        const EmscriptenTouchPoint* event = &(touchEvent->touches[0]);
-        d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
-        d->touchStartPos = d->mousePos;
+    case EMSCRIPTEN_EVENT_TOUCHSTART:  input.type = TouchInputType::Start;  break;
+    case EMSCRIPTEN_EVENT_TOUCHEND:    input.type = TouchInputType::End;    break;
+    case EMSCRIPTEN_EVENT_TOUCHMOVE:   input.type = TouchInputType::Move;   break;
+    case EMSCRIPTEN_EVENT_TOUCHCANCEL: input.type = TouchInputType::Cancel; break;
+    default: return EM_TRUE;
+    }
 
-        d->firstPress = d->secondPress;
-        d->secondPress = tp_utils::currentTimeMS();
-      }
-      else if(touchEvent->numTouches == 2)
-      {
-        if(d->touchMode == TouchMode_lt::Pan)
-        {
-          tp_maps::MouseEvent e(tp_maps::MouseEventType::Release);
-          e.pos = d->mousePos;
-          e.button = tp_maps::Button::LeftButton;
-          e.modifiers = modifiers;
-          d->q->mouseEvent(e);
-        }
-
-        d->touchMode = TouchMode_lt::ZoomRotate;
-        d->invalidateDoubleTap();
-
-        d->zoomRotateAPos = glm::vec2(touchEvent->touches[0].targetX, touchEvent->touches[0].targetY);
-        d->zoomRotateBPos = glm::vec2(touchEvent->touches[1].targetX, touchEvent->touches[1].targetY);
-        d->zoomRotateDist = glm::length(d->zoomRotateAPos - d->zoomRotateBPos);
-
-        glm::vec2 m = d->zoomRotateBPos + ((d->zoomRotateAPos-d->zoomRotateBPos) / 2.0f);
-        d->mousePos = d->scaleMouseCoord(m.x, m.y);
-      }
-      else
-      {
-        d->touchMode = TouchMode_lt::Invalid;
-        d->invalidateDoubleTap();
-      }
+    d->q->touchInput(input);
+    return EM_TRUE;
+  }
 
-      break;
-    }
-    case EMSCRIPTEN_EVENT_TOUCHEND: //--------------------------------------------------------------
+  //################################################################################################
+  //! Register per canvas html5 callbacks, used when the map is not driven by a MapManager.
+  bool installEventHandlers()
+  {
+    for(auto callback : {
+        emscripten_set_click_callback_on_thread     ,
+        emscripten_set_mousedown_callback_on_thread ,
+        emscripten_set_mouseup_callback_on_thread   ,
+        emscripten_set_dblclick_callback_on_thread  ,
+        emscripten_set_mousemove_callback_on_thread ,
+        emscripten_set_mouseenter_callback_on_thread,
+        emscripten_set_mouseleave_callback_on_thread})
     {
-      if(touchEvent->numTouches == 1)
-      {
-        if(d->touchMode == TouchMode_lt::Pan)
-        {
-          const EmscriptenTouchPoint* event = &(touchEvent->touches[0]);
-          tp_maps::MouseEvent e(tp_maps::MouseEventType::Release);
-          d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
-          e.pos = d->mousePos;
-          e.button = tp_maps::Button::LeftButton;
-          e.modifiers = modifiers;
-          d->q->mouseEvent(e);
-        }
-        else
-        {
-          if((tp_utils::currentTimeMS() - d->firstPress) < 400)
-          {
-            tp_maps::MouseEvent e(tp_maps::MouseEventType::DoubleClick);
-            e.pos = d->mousePos;
-            e.button = tp_maps::Button::LeftButton;
-            e.modifiers = modifiers;
-            d->q->mouseEvent(e);
-          }
-          else if(d->touchMode == TouchMode_lt::New)
-          {
-            if((tp_utils::currentTimeMS() - d->secondPress) < 400)
-            {
-              {
-                tp_maps::MouseEvent e(tp_maps::MouseEventType::Press);
-                e.pos = d->touchStartPos;
-                e.button = tp_maps::Button::LeftButton;
-                e.modifiers = modifiers;
-                d->q->mouseEvent(e);
-              }
-
-              {
-                const EmscriptenTouchPoint* event = &(touchEvent->touches[0]);
-                tp_maps::MouseEvent e(tp_maps::MouseEventType::Release);
-                d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
-                e.pos = d->mousePos;
-                e.button = tp_maps::Button::LeftButton;
-                e.modifiers = modifiers;
-                d->q->mouseEvent(e);
-              }
-            }
-          }
-        }
-      }
-      else
+      if(callback(canvasID.c_str(),
+                  this,
+                  EM_TRUE,
+                  mouseCallback,
+                  EM_CALLBACK_THREAD_CONTEXT_CALLING_THREAD) != EMSCRIPTEN_RESULT_SUCCESS)
       {
+        tpWarning() << "Failed to install mouse callback for: " << canvasID;
+        return false;
       }
+    }
 
-      break;
+    if(emscripten_set_wheel_callback(canvasID.c_str(),
+                                     this,
+                                     EM_TRUE,
+                                     wheelCallback) != EMSCRIPTEN_RESULT_SUCCESS)
+    {
+      tpWarning() << "Failed to install wheel callback for: " << canvasID;
+      return false;
     }
-    case EMSCRIPTEN_EVENT_TOUCHMOVE: //-------------------------------------------------------------
+
+    for(auto callback : {
+        emscripten_set_touchstart_callback_on_thread ,
+        emscripten_set_touchend_callback_on_thread   ,
+        emscripten_set_touchmove_callback_on_thread  ,
+        emscripten_set_touchcancel_callback_on_thread})
     {
-      if(touchEvent->numTouches == 1)
+      if(callback(canvasID.c_str(),
+                  this,
+                  EM_TRUE,
+                  touchCallback,
+                  EM_CALLBACK_THREAD_CONTEXT_CALLING_THREAD) != EMSCRIPTEN_RESULT_SUCCESS)
       {
-        if(d->touchMode == TouchMode_lt::Pan || d->touchMode == TouchMode_lt::New)
-        {
-          const EmscriptenTouchPoint* event = &(touchEvent->touches[0]);
-          d->mousePos = d->scaleMouseCoord(event->targetX, event->targetY);
-
-          if(d->touchMode == TouchMode_lt::Pan)
-          {
-            tp_maps::MouseEvent e(tp_maps::MouseEventType::Move);
-            e.pos = d->mousePos;
-            e.modifiers = modifiers;
-            d->q->mouseEvent(e);
-          }
-          else
-          {
-            int ox = std::abs(d->touchStartPos.x - d->mousePos.x);
-            int oy = std::abs(d->touchStartPos.y - d->mousePos.y);
-            if((ox+oy) > 10)
-            {
-              d->touchMode = TouchMode_lt::Pan;
-              tp_maps::MouseEvent e(tp_maps::MouseEventType::Press);
-              e.pos = d->touchStartPos;
-              e.button = tp_maps::Button::LeftButton;
-              e.modifiers = modifiers;
-              d->q->mouseEvent(e);
-              d->invalidateDoubleTap();
-            }
-          }
-        }
+        tpWarning() << "Failed to install touch callback for: " << canvasID;
+        return false;
       }
-      else if(touchEvent->numTouches == 2)
-      {
-        if(d->touchMode == TouchMode_lt::New)
-          d->touchMode = TouchMode_lt::ZoomRotate;
-
-        if(d->touchMode == TouchMode_lt::ZoomRotate)
-        {
-          glm::vec2 zoomRotateAPos = glm::vec2(touchEvent->touches[0].targetX, touchEvent->touches[0].targetY);
-          glm::vec2 zoomRotateBPos = glm::vec2(touchEvent->touches[1].targetX, touchEvent->touches[1].targetY);
-          float zoomRotateDist = glm::length(zoomRotateAPos - zoomRotateBPos);
-
-          tp_maps::MouseEvent e(tp_maps::MouseEventType::Wheel);
-          e.modifiers = modifiers;
-          e.delta = (zoomRotateDist - d->zoomRotateDist) * 5.0f;
-          if(std::abs(e.delta)>1)
-          {
-            e.pos = d->mousePos;
-            d->q->mouseEvent(e);
-
-            d->zoomRotateAPos = zoomRotateAPos;
-            d->zoomRotateBPos = zoomRotateBPos;
-            d->zoomRotateDist = zoomRotateDist;
-          }
-        }
-      }
-      break;
-    }
-    case EMSCRIPTEN_EVENT_TOUCHCANCEL:
-    {
-      break;
-    }
     }
 
-    return EM_TRUE;
+    return true;
   }
 };
 
 //##################################################################################################
-Map::Map(const char* canvasID, bool enableDepthBuffer):
+Map::Map(const char* canvasID, bool enableDepthBuffer, bool installEventHandlers):
   tp_maps::Map(enableDepthBuffer),
   d(new Private(this, canvasID))
 {
@@ -499,53 +381,18 @@ Map::Map(const char* canvasID, bool enableDepthBuffer):
     return;
   }
 
-  for(auto callback : {
-      emscripten_set_click_callback_on_thread     ,
-      emscripten_set_mousedown_callback_on_thread ,
-      emscripten_set_mouseup_callback_on_thread   ,
-      emscripten_set_dblclick_callback_on_thread  ,
-      emscripten_set_mousemove_callback_on_thread ,
-      emscripten_set_mouseenter_callback_on_thread,
-      emscripten_set_mouseleave_callback_on_thread})
-  {
-    if(callback(canvasID,
-                d,
-                EM_TRUE,
-                Private::mouseCallback,
-                EM_CALLBACK_THREAD_CONTEXT_CALLING_THREAD) != EMSCRIPTEN_RESULT_SUCCESS)
-    {
-      d->error = true;
-      tpWarning() << "Failed to install mouse callback for: " << canvasID;
-      return;
-    }
-  }
+  installGLStateCache(d->context);
+  installGPUMemoryAccounting(d->context);
 
-  if(emscripten_set_wheel_callback(canvasID,
-                                   d,
-                                   EM_TRUE,
-                                   Private::wheelCallback) != EMSCRIPTEN_RESULT_SUCCESS)
+  d->frameCapture = std::make_unique<FrameCapture>(d->attributes.majorVersion == 2, [this](const std::function<void()>& callback)
   {
-    d->error = true;
-    tpWarning() << "Failed to install wheel callback for: " << canvasID;
-    return;
-  }
+    callAsync(callback);
+  });
 
-  for(auto callback : {
-      emscripten_set_touchstart_callback_on_thread ,
-      emscripten_set_touchend_callback_on_thread   ,
-      emscripten_set_touchmove_callback_on_thread  ,
-      emscripten_set_touchcancel_callback_on_thread})
+  if(installEventHandlers && !d->installEventHandlers())
   {
-    if(callback(canvasID,
-                d,
-                EM_TRUE,
-                Private::touchCallback,
-                EM_CALLBACK_THREAD_CONTEXT_CALLING_THREAD) != EMSCRIPTEN_RESULT_SUCCESS)
-    {
-      d->error = true;
-      tpWarning() << "Failed to install touch callback for: " << canvasID;
-      return;
-    }
+    d->error = true;
+    return;
   }
 
   initializeGL();
@@ -557,6 +404,13 @@ Map::Map(const char* canvasID, bool enableDepthBuffer):
 Map::~Map()
 {
   preDelete();
+
+  if(d->frameCapture)
+  {
+    tp_maps_emcc::Map::makeCurrent();
+    d->frameCapture.reset();
+  }
+
   if(emscripten_webgl_destroy_context(d->context) != EMSCRIPTEN_RESULT_SUCCESS)
     tpWarning() << "Failed to delete context: " << d->context;
   delete d;
@@ -568,22 +422,108 @@ const std::string& Map::canvasID()const
   return d->canvasID;
 }
 
+//##################################################################################################
+bool Map::hasError() const
+{
+  return d->error;
+}
+
+//##################################################################################################
+void Map::recycle()
+{
+  tp_maps_emcc::Map::makeCurrent();
+
+  while(!layers().empty())
+  {
+    tp_maps::Layer* layer = layers().back();
+    removeLayer(layer);
+    delete layer;
+  }
+
+  if(d->pointerLock)
+  {
+    emscripten_exit_pointerlock();
+    d->pointerLock = false;
+  }
+
+  if(d->frameCapture)
+    d->frameCapture->clear();
+
+  d->asyncCallbacks.clear();
+  d->dataIngest.clear();
+  d->inputLatency.reset();
+  d->updateRequested = false;
+
+  // Return the settings and counters to their defaults so the next owner starts fresh.
+  d->usePointerLock = false;
+  d->progressive = false;
+  d->frameBudgetMS = 16.0;
+  d->levelCostMS.fill(0.0);
+  if(d->level != Private::fullLevel)
+  {
+    d->level = Private::fullLevel;
+    d->applyResolution();
+  }
+  d->frameCount = 0;
+  resetGLCallStats();
+}
+
+//##################################################################################################
+bool Map::rebind(const char* canvasID, bool replaceCanvas)
+{
+  if(!tp_maps_emcc_rebind_canvas(int(d->context), canvasID, replaceCanvas?1:0))
+  {
+    if(replaceCanvas)
+      tpWarning() << "Failed to rebind map to canvas: " << canvasID;
+    return false;
+  }
+
+  d->canvasID = canvasID;
+  resize();
+  d->updateRequested = true;
+  return true;
+}
+
 //##################################################################################################
 void Map::processEvents()
 {
-  // ENG-925 make a local copy because the callbacks may invoke callAsync() which adds to the end of the list
-  std::vector<std::function<void()>> asyncCallbacks;
-  asyncCallbacks.swap(d->asyncCallbacks);
-  for(const auto& callback : asyncCallbacks)
-    callback();
+  bool capturing=false;
+  if(d->frameCapture && d->frameCapture->active())
+  {
+    tp_maps_emcc::Map::makeCurrent();
+    d->frameCapture->poll();
+
+    // Keep painting while a sequence runs or a single shot capture waits for a free slot, so that a
+    // static view still produces frames.
+    capturing = d->frameCapture->needsFrame();
+    if(capturing)
+      d->updateRequested = true;
+  }
+
+  processAsyncCallbacks();
 
   try
   {
-    if(!d->updateRequested)
+    size_t level;
+    double now = emscripten_get_now();
+    if(d->updateRequested)
+    {
+      // New input or updates postpone refinement, only full resolution is captured.
+      d->lastUpdateMS = now;
+      level = (d->progressive && !capturing)?d->interactiveLevel():Private::fullLevel;
+    }
+    else if(d->level<Private::fullLevel && (now-d->lastUpdateMS)>=Private::refineDelayMS)
+    {
+      level = Private::fullLevel;
+    }
+    else
       return;
 
-    d->update();
+    TraceScope trace("paintGL", d->canvasID.c_str(), int64_t(level));
+    d->update(level);
     d->updateRequested = false;
+    d->frameCount++;
+    d->inputLatency.paintFinished(emscripten_get_now());
   }
   catch (...)
   {
@@ -591,9 +531,48 @@ void Map::processEvents()
   }
 }
 
+//##################################################################################################
+void Map::processAsyncCallbacks()
+{
+  if(d->asyncCallbacks.empty())
+    return;
+
+  // Callbacks such as texture loads expect this map's context.
+  tp_maps_emcc::Map::makeCurrent();
+
+  // ENG-925 make a local copy because the callbacks may invoke callAsync() which adds to the end of the list
+  std::vector<std::function<void()>> asyncCallbacks;
+  asyncCallbacks.swap(d->asyncCallbacks);
+  for(size_t i=0; i<asyncCallbacks.size(); i++)
+  {
+    TraceScope trace("callAsync", d->canvasID.c_str(), int64_t(i));
+    asyncCallbacks.at(i)();
+  }
+}
+
+//##################################################################################################
+size_t Map::frameCount() const
+{
+  return d->frameCount;
+}
+
+//##################################################################################################
+void Map::requestFrame()
+{
+  d->updateRequested = true;
+}
+
 //##################################################################################################
 void Map::makeCurrent()
 {
+  // Every WebGL call crosses into JavaScript, skip it if the context is already current.
+  if(emscripten_webgl_get_current_context() == d->context)
+  {
+    d->makeCurrentElided++;
+    return;
+  }
+
+  d->makeCurrentIssued++;
   if(emscripten_webgl_make_context_current(d->context) != EMSCRIPTEN_RESULT_SUCCESS)
   {
     d->error = true;
@@ -606,7 +585,8 @@ void Map::update(const tp_maps::RenderFromStage& renderFromStage, const std::vec
 {
   tp_maps::Map::update(renderFromStage, subviews);
 
-  if(tpContains(subviews, tp_maps::defaultSID()))
+  // Changing the resolution level is not a new request and should not cancel refinement.
+  if(tpContains(subviews, tp_maps::defaultSID()) && !d->applyingLevel)
     d->updateRequested = true;
 }
 
@@ -616,21 +596,29 @@ void Map::callAsync(const std::function<void()>& callback)
   d->asyncCallbacks.push_back(callback);
 }
 
+//##################################################################################################
+bool Map::asyncCallbacksPending() const
+{
+  return !d->asyncCallbacks.empty();
+}
+
 //##################################################################################################
 float Map::pixelScale() const
 {
-  return d->pixelScale;
+  return d->input.pixelScale();
 }
 
 //##################################################################################################
 void Map::resize()
 {
+  TraceScope trace("resize", d->canvasID.c_str());
+
   tp_maps_emcc::Map::makeCurrent();
 
-  d->pixelScale = emscripten_get_device_pixel_ratio();
+  float pixelScale = emscripten_get_device_pixel_ratio();
 
-  if(d->pixelScale<0.1f || d->pixelScale>30.0f)
-    d->pixelScale = 1.0f;
+  if(pixelScale<0.1f || pixelScale>30.0f)
+    pixelScale = 1.0f;
 
 #if 0
   // Debug out some of the values returned by Emscripten.
@@ -660,15 +648,200 @@ void Map::resize()
   double height{0};
   emscripten_get_element_css_size(d->canvasID.data(), &width, &height);
 
-  int w = int(float(width)  * d->pixelScale + 0.5f);
-  int h = int(float(height) * d->pixelScale + 0.5f);
+  tpWarning() << "Resize event w: " << width << " h: " << height << " scale: " << pixelScale << " canvasID: " << d->canvasID;
+
+  d->devicePixelScale = pixelScale;
+  d->cssWidth = width;
+  d->cssHeight = height;
+
+  // Resizing invalidates the per level costs.
+  d->levelCostMS.fill(0.0);
+  d->level = Private::fullLevel;
+  d->applyResolution();
+  d->updateRequested = true;
+}
+
+//##################################################################################################
+bool Map::renderToPixels(int width, int height, std::vector<uint8_t>& pixels)
+{
+  if(d->error || width<1 || height<1)
+    return false;
+
+  tp_maps_emcc::Map::makeCurrent();
+
+  if(width != this->width() || height != this->height())
+  {
+    emscripten_set_canvas_element_size(d->canvasID.data(), width, height);
+    d->applyingLevel = true;
+    resizeGL(width, height);
+    d->applyingLevel = false;
+  }
+
+  paintGL();
+  d->updateRequested = false;
+
+  pixels.resize(size_t(width)*size_t(height)*4);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+  return !d->error;
+}
 
-  tpWarning() << "Resize event w: " << width << " h: " << height << " scale: " << d->pixelScale << " canvasID: " << d->canvasID;
+//##################################################################################################
+void Map::setProgressiveRendering(bool progressive, double frameBudgetMS)
+{
+  d->progressive = progressive;
+  d->frameBudgetMS = frameBudgetMS;
 
-  emscripten_set_canvas_element_size(d->canvasID.data(), w, h);
-  emscripten_set_element_css_size(d->canvasID.data(), width, height);
+  // Let the next paint converge to full resolution.
+  if(!progressive)
+    d->updateRequested = true;
+}
+
+//##################################################################################################
+bool Map::progressiveRendering() const
+{
+  return d->progressive;
+}
 
-  resizeGL(w, h);
+//##################################################################################################
+void Map::captureFrameAsync(const std::function<void(const CapturedFrame&)>& callback)
+{
+  if(!d->frameCapture)
+    return;
+
+  d->frameCapture->captureFrame(callback);
+  d->updateRequested = true;
+}
+
+//##################################################################################################
+void Map::startFrameSequenceCapture(const std::function<void(const CapturedFrame&)>& callback)
+{
+  if(d->frameCapture)
+    d->frameCapture->startSequence(callback);
+}
+
+//##################################################################################################
+void Map::stopFrameSequenceCapture()
+{
+  if(d->frameCapture)
+    d->frameCapture->stopSequence();
+}
+
+//##################################################################################################
+size_t Map::droppedCaptureFrames() const
+{
+  return d->frameCapture?d->frameCapture->droppedFrames():0;
+}
+
+//##################################################################################################
+const InputLatencyStats& Map::inputLatencyStats() const
+{
+  return d->inputLatency.stats();
+}
+
+//##################################################################################################
+void Map::resetInputLatencyStats()
+{
+  d->inputLatency.reset();
+}
+
+//##################################################################################################
+void Map::mouseInput(const MouseInput& mouseInput)
+{
+  MouseInput input = mouseInput;
+  input.pointerLocked = false;
+
+  switch(input.type)
+  {
+  case MouseInputType::Down: //---------------------------------------------------------------------
+  {
+    if(d->usePointerLock)
+    {
+      d->requestPointerLock();
+      d->pointerLock = true;
+    }
+    break;
+  }
+  case MouseInputType::Up: //-----------------------------------------------------------------------
+  case MouseInputType::Leave: //--------------------------------------------------------------------
+  {
+    if(d->usePointerLock)
+    {
+      emscripten_exit_pointerlock();
+      d->pointerLock = false;
+    }
+    break;
+  }
+  case MouseInputType::Move: //---------------------------------------------------------------------
+  {
+    if(d->pointerLock)
+    {
+      // Until the lock is active hold the current position.
+      input.pointerLocked = true;
+      EmscriptenPointerlockChangeEvent pointerlockStatus;
+      if(emscripten_get_pointerlock_status(&pointerlockStatus)!=EMSCRIPTEN_RESULT_SUCCESS ||
+         pointerlockStatus.isActive != EM_TRUE)
+      {
+        input.movementX = 0;
+        input.movementY = 0;
+      }
+    }
+    break;
+  }
+  case MouseInputType::DoubleClick: //--------------------------------------------------------------
+  {
+    break;
+  }
+  }
+
+  d->translate(InputEventType::Mouse, input.eventTimeMS, [&]{d->input.mouseInput(input);});
+}
+
+//##################################################################################################
+void Map::wheelInput(const WheelInput& input)
+{
+  d->translate(InputEventType::Wheel, input.eventTimeMS, [&]{d->input.wheelInput(input);});
+}
+
+//##################################################################################################
+void Map::touchInput(const TouchInput& input)
+{
+  d->translate(InputEventType::Touch, input.eventTimeMS, [&]{d->input.touchInput(input);});
+}
+
+//##################################################################################################
+DataIngest& Map::dataIngest()
+{
+  return d->dataIngest;
+}
+
+//##################################################################################################
+GLCallStats Map::glCallStats() const
+{
+  GLCallStats stats;
+  glStateCacheStats(d->context, stats, false);
+  stats.makeCurrentIssued = d->makeCurrentIssued;
+  stats.makeCurrentElided = d->makeCurrentElided;
+  return stats;
+}
+
+//##################################################################################################
+void Map::resetGLCallStats()
+{
+  GLCallStats stats;
+  glStateCacheStats(d->context, stats, true);
+  d->makeCurrentIssued = 0;
+  d->makeCurrentElided = 0;
+}
+
+//##################################################################################################
+GPUMemoryStats Map::gpuMemoryStats() const
+{
+  GPUMemoryStats stats;
+  tp_maps_emcc::gpuMemoryStats(d->context, stats);
+  return stats;
 }
 
 //##################################################################################################
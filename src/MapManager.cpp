@@ -1,5 +1,11 @@
 #include "tp_maps_emcc/MapManager.h"
 #include "tp_maps_emcc/Map.h"
+#include "tp_maps_emcc/Trace.h"
+#include "tp_maps_emcc/BatchRenderQueue.h"
+#include "tp_maps_emcc/InputTranslator.h"
+#include "tp_maps_emcc/AssetCache.h"
+#include "tp_maps_emcc/Coroutines.h"
+#include "tp_maps_emcc/MemoryAccounting.h"
 
 #include "tp_utils/DebugUtils.h"
 #include "tp_utils/TimeUtils.h"
@@ -11,6 +17,156 @@
 #include <emscripten.h>
 #include <emscripten/html5.h>
 
+#include <memory>
+#include <unordered_map>
+
+//##################################################################################################
+//! Install one set of document level mouse listeners that route events to maps by canvas.
+/*!
+Canvases are tagged with the router and a slot index by tp_maps_emcc_bind_canvas, each event reads
+these from its target so lookup is constant time regardless of the number of maps. Coordinates are
+made relative to the canvas in the same way as the html5 callbacks. Touch points are the union of
+touches and changedTouches, matching the numTouches reported by Emscripten.
+
+Wheel and touch listeners must not be passive so that they can stop the page scrolling, on the
+document that would make every scroll on the page wait for the main loop. These are created here
+but added to each canvas by tp_maps_emcc_bind_canvas.
+*/
+EM_JS(void, tp_maps_emcc_install_listeners, (void* router), {
+  function slotOf(target) {
+    return (target && target.__tpMapsEmccRouter === router) ? target.__tpMapsEmccSlot : -1;
+  }
+
+  function modifiers(e) {
+    return (e.shiftKey?1:0) | (e.ctrlKey?2:0) | (e.altKey?4:0);
+  }
+
+  function mouse(type) {
+    return function(e) {
+      var slot = slotOf(e.target);
+      if(slot<0)
+        return;
+      var rect = e.target.getBoundingClientRect();
+      _tp_maps_emcc_dispatch_mouse(router, slot, type, e.button, e.clientX-rect.left, e.clientY-rect.top, e.movementX|0, e.movementY|0, modifiers(e), e.timeStamp);
+      e.preventDefault();
+    };
+  }
+
+  var mouseLeave = mouse(4);
+  function mouseOut(e) {
+    if(e.relatedTarget !== e.target)
+      mouseLeave(e);
+  }
+
+  function wheel(e) {
+    var slot = slotOf(e.currentTarget);
+    if(slot<0)
+      return;
+    _tp_maps_emcc_dispatch_wheel(router, slot, e.deltaY, e.timeStamp);
+    e.preventDefault();
+  }
+
+  function touch(type) {
+    return function(e) {
+      var slot = slotOf(e.currentTarget);
+      if(slot<0)
+        return;
+      var rect = e.currentTarget.getBoundingClientRect();
+      var points = [];
+      var seen = {};
+      [e.touches, e.changedTouches].forEach(function(list) {
+        for(var i=0; i<list.length; i++) {
+          if(!seen[list[i].identifier]) {
+            seen[list[i].identifier] = true;
+            points.push(list[i]);
+          }
+        }
+      });
+      var a = points[0] || {clientX: rect.left, clientY: rect.top};
+      var b = points[1] || a;
+      _tp_maps_emcc_dispatch_touch(router, slot, type, points.length,
+                                   a.clientX-rect.left, a.clientY-rect.top,
+                                   b.clientX-rect.left, b.clientY-rect.top, modifiers(e), e.timeStamp);
+      e.preventDefault();
+    };
+  }
+
+  var documentListeners = [["mousedown", mouse(0)],
+                           ["mouseup"  , mouse(1)],
+                           ["dblclick" , mouse(2)],
+                           ["mousemove", mouse(3)],
+                           ["mouseout" , mouseOut]];
+
+  var canvasListeners = [["wheel"      , wheel],
+                         ["touchstart" , touch(0)],
+                         ["touchend"   , touch(1)],
+                         ["touchmove"  , touch(2)],
+                         ["touchcancel", touch(3)]];
+
+  documentListeners.forEach(function(l) {
+    document.addEventListener(l[0], l[1], {capture: true, passive: false});
+  });
+
+  // Bound canvases by slot, so that they can be untagged even once they have left the document.
+  var canvases = {};
+  function unbind(slot) {
+    var bound = canvases[slot];
+    if(!bound)
+      return;
+    canvasListeners.forEach(function(l) {
+      bound.canvas.removeEventListener(l[0], l[1], {capture: false});
+    });
+    bound.canvas.style.touchAction = bound.touchAction;
+    delete bound.canvas.__tpMapsEmccRouter;
+    delete bound.canvas.__tpMapsEmccSlot;
+    delete canvases[slot];
+  }
+
+  Module["tpMapsEmccListeners" + router] = {document: documentListeners,
+                                            canvas: canvasListeners,
+                                            canvases: canvases,
+                                            unbind: unbind};
+});
+
+//##################################################################################################
+EM_JS(void, tp_maps_emcc_unbind_canvas, (void* router, int slot), {
+  var listeners = Module["tpMapsEmccListeners" + router];
+  if(listeners)
+    listeners.unbind(slot);
+});
+
+//##################################################################################################
+EM_JS(void, tp_maps_emcc_remove_listeners, (void* router), {
+  var listeners = Module["tpMapsEmccListeners" + router];
+  if(!listeners)
+    return;
+  Object.keys(listeners.canvases).forEach(listeners.unbind);
+  listeners.document.forEach(function(l) {
+    document.removeEventListener(l[0], l[1], {capture: true});
+  });
+  delete Module["tpMapsEmccListeners" + router];
+});
+
+//##################################################################################################
+//! Tag a canvas with the router and slot and add the wheel and touch listeners to it.
+EM_JS(void, tp_maps_emcc_bind_canvas, (const char* canvasID, void* router, int slot), {
+  var listeners = Module["tpMapsEmccListeners" + router];
+  var canvas = document.querySelector(UTF8ToString(canvasID));
+  if(!listeners || !canvas)
+    return;
+
+  listeners.unbind(slot);
+  listeners.canvas.forEach(function(l) {
+    canvas.addEventListener(l[0], l[1], {capture: false, passive: false});
+  });
+
+  // Let the browser know up front that touches on the canvas do not scroll or zoom the page.
+  listeners.canvases[slot] = {canvas: canvas, touchAction: canvas.style.touchAction};
+  canvas.style.touchAction = "none";
+  canvas.__tpMapsEmccRouter = router;
+  canvas.__tpMapsEmccSlot = slot;
+});
+
 namespace tp_maps_emcc
 {
 
@@ -24,7 +180,70 @@ MapDetails::MapDetails(Map* map_):
 //##################################################################################################
 MapDetails::~MapDetails()
 {
-  delete map;
+  if(!m_recycleMap)
+    delete map;
+}
+
+//##################################################################################################
+bool MapDetails::recycleMap() const
+{
+  return m_recycleMap;
+}
+
+namespace
+{
+//##################################################################################################
+//! Maps the slot index that a canvas is tagged with to its Map.
+struct InputRouter_lt
+{
+  std::vector<Map*> slots;
+  std::vector<int> freeSlots;
+
+  //################################################################################################
+  int add(Map* map)
+  {
+    if(!freeSlots.empty())
+    {
+      int slot = freeSlots.back();
+      freeSlots.pop_back();
+      slots[size_t(slot)] = map;
+      return slot;
+    }
+
+    slots.push_back(map);
+    return int(slots.size()-1);
+  }
+
+  //################################################################################################
+  void remove(int slot)
+  {
+    slots.at(size_t(slot)) = nullptr;
+    freeSlots.push_back(slot);
+  }
+
+  //################################################################################################
+  Map* map(int slot) const
+  {
+    return (slot>=0 && size_t(slot)<slots.size())?slots[size_t(slot)]:nullptr;
+  }
+
+  //################################################################################################
+  static tp_maps::KeyboardModifier modifiers(int bits)
+  {
+    tp_maps::KeyboardModifier modifiers{tp_maps::KeyboardModifier::None};
+    if(bits&1) modifiers = modifiers | tp_maps::KeyboardModifier::Shift;
+    if(bits&2) modifiers = modifiers | tp_maps::KeyboardModifier::Control;
+    if(bits&4) modifiers = modifiers | tp_maps::KeyboardModifier::Alt;
+    return modifiers;
+  }
+};
+
+//##################################################################################################
+struct PooledMap_lt
+{
+  Map* map;
+  int64_t pooledAt;
+};
 }
 
 //##################################################################################################
@@ -34,6 +253,32 @@ struct MapManager::Private
   std::function<MapDetails*(Map*)> createMapDetails;
   std::vector<MapDetails*> maps;
 
+  InputRouter_lt inputRouter;
+  std::unordered_map<MapDetails*, int> slots;
+
+  MapDetails* batchDetails{nullptr};
+  std::unique_ptr<BatchRenderQueue> batchQueue;
+  double batchRenderBudgetMS{8.0};
+
+  AssetCache assetCache;
+
+  CoroutineScheduler coroutineScheduler;
+  size_t animateTicks{0};
+
+  HeapStats heapStats;
+  size_t heapSoftLimit{0};
+  size_t gpuSoftLimit{0};
+  bool overMemoryLimit{false};
+  int64_t nextMemoryCheck{0};
+
+  std::vector<PooledMap_lt> mapPool;
+  size_t mapPoolSize{0};
+  bool mapPoolReplaceCanvas{false};
+
+  // Browsers lose the oldest context once a page has more than this, Chrome allows 16.
+  static constexpr size_t contextLimit{16};
+  int64_t mapPoolIdleTimeoutMS{60000};
+
   int64_t animateInterval{5};
   int64_t nextAnimate{tp_utils::currentTimeMS()+animateInterval};
 
@@ -46,7 +291,136 @@ struct MapManager::Private
     q(q_),
     createMapDetails(createMapDetails_)
   {
+    tp_maps_emcc_install_listeners(&inputRouter);
+
+    if(emscripten_set_resize_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW,
+                                      this,
+                                      EM_TRUE,
+                                      resizeCallback) != EMSCRIPTEN_RESULT_SUCCESS)
+      tpWarning() << "Failed to install resize callback.";
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    emscripten_set_resize_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, nullptr, EM_TRUE, nullptr);
+    tp_maps_emcc_remove_listeners(&inputRouter);
+
+    batchQueue.reset();
+    delete batchDetails;
+
+    for(const auto& pooled : mapPool)
+      delete pooled.map;
+  }
+
+  //################################################################################################
+  //! Take a map from the pool and bind it to the canvas, returns nullptr if none can be used.
+  /*!
+  A map that already renders to the canvas is preferred, otherwise the most recently pooled map has
+  its canvas moved into place if mapPoolReplaceCanvas is set.
+  */
+  Map* takePooledMap(const char* canvasID)
+  {
+    for(size_t i=mapPool.size(); i>0; i--)
+    {
+      if(Map* map = mapPool.at(i-1).map; map->rebind(canvasID))
+      {
+        mapPool.erase(mapPool.begin()+ptrdiff_t(i-1));
+        return map;
+      }
+    }
+
+    if(mapPoolReplaceCanvas && !mapPool.empty())
+    {
+      Map* map = mapPool.back().map;
+      mapPool.pop_back();
+
+      if(map->rebind(canvasID, true))
+        return map;
+
+      delete map;
+    }
+
+    return nullptr;
+  }
+
+  //################################################################################################
+  //! Destroy maps that have been idle too long, then the oldest until the pool fits mapPoolSize.
+  /*!
+  The pool is also trimmed so that it and the live maps, plus reserve maps about to be created,
+  stay within contextLimit.
+  */
+  void trimMapPool(int64_t now, size_t reserve=0)
+  {
+    for(size_t i=0; i<mapPool.size();)
+    {
+      if((now-mapPool.at(i).pooledAt)<mapPoolIdleTimeoutMS)
+      {
+        i++;
+        continue;
+      }
+
+      delete mapPool.at(i).map;
+      mapPool.erase(mapPool.begin()+i);
+    }
+
+    size_t live = maps.size() + (batchDetails?1:0) + reserve;
+    while(!mapPool.empty() && (mapPool.size()>mapPoolSize || mapPool.size()+live>contextLimit))
+    {
+      delete mapPool.front().map;
+      mapPool.erase(mapPool.begin());
+    }
+  }
+
+  //################################################################################################
+  BatchRenderQueue* batchRenderQueue()
+  {
+    if(!batchQueue)
+    {
+      // Emscripten treats canvas IDs as CSS selectors.
+      const char* canvasID = "#tp_maps_emcc_batch_canvas";
+      EM_ASM({
+               var id = UTF8ToString($0).substring(1);
+               if(!document.getElementById(id))
+               {
+                 var canvas = document.createElement("canvas");
+                 canvas.id = id;
+                 canvas.style.display = "none";
+                 document.body.appendChild(canvas);
+               }
+             }, canvasID);
+
+      trimMapPool(tp_utils::currentTimeMS(), 1);
+      batchDetails = createMapDetails(new tp_maps_emcc::Map(canvasID, false, false));
+      batchQueue = std::make_unique<BatchRenderQueue>(batchDetails->map, [](tp_maps::Map* map, int width, int height, std::vector<uint8_t>& pixels)
+      {
+        return static_cast<Map*>(map)->renderToPixels(width, height, pixels);
+      },
+      [](tp_maps::Map* map)
+      {
+        // Wait for anything prepare started loading through callAsync.
+        return !static_cast<Map*>(map)->asyncCallbacksPending();
+      });
+    }
+
+    return batchQueue.get();
+  }
+
+  //################################################################################################
+  void processBatchRender()
+  {
+    if(!batchQueue)
+      return;
+
+    if(!batchQueue->pending())
+      return;
 
+    // Let the batch map run its async callbacks, such as texture loads. It is only painted by
+    // renderToPixels() once a job is ready, never by processEvents().
+    batchDetails->map->processAsyncCallbacks();
+
+    TraceScope trace("batchRender");
+    batchQueue->process(batchRenderBudgetMS);
   }
 
   //################################################################################################
@@ -55,9 +429,18 @@ struct MapManager::Private
     if(auto t=tp_utils::currentTimeMS(); t>nextAnimate)
     {
       nextAnimate = t+animateInterval;
-      q->animateCallbacks(t);
+
+      {
+        TraceScope trace("animateCallbacks");
+        q->animateCallbacks(t);
+      }
+      animateTicks++;
+
       for(MapDetails* details : maps)
+      {
+        TraceScope trace("animate", details->map->canvasID().c_str());
         details->map->animate(t);
+      }
     }
   }
 
@@ -68,6 +451,64 @@ struct MapManager::Private
       details->map->processEvents();
   }
 
+  //################################################################################################
+  MemoryStats memoryStats()
+  {
+    MemoryStats stats;
+    sampleHeapStats(heapStats);
+    stats.heap = heapStats;
+
+    auto add = [](GPUMemoryStats& total, Map* map)
+    {
+      GPUMemoryStats gpu = map->gpuMemoryStats();
+      total.bufferBytes        += gpu.bufferBytes;
+      total.textureBytes       += gpu.textureBytes;
+      total.renderbufferBytes  += gpu.renderbufferBytes;
+      total.drawingBufferBytes += gpu.drawingBufferBytes;
+    };
+
+    for(MapDetails* details : maps)
+      add(stats.gpu, details->map);
+
+    if(batchDetails)
+      add(stats.gpu, batchDetails->map);
+
+    for(const auto& pooled : mapPool)
+      add(stats.pooledGPU, pooled.map);
+
+    return stats;
+  }
+
+  //################################################################################################
+  void checkMemory()
+  {
+#ifndef TP_MAPS_EMCC_NO_MEMORY_ACCOUNTING
+    if(auto t=tp_utils::currentTimeMS(); t>nextMemoryCheck)
+    {
+      nextMemoryCheck = t+1000;
+
+      // Sample the heap even without limits so that its growth and peak are tracked.
+      if(!heapSoftLimit && !gpuSoftLimit)
+      {
+        sampleHeapStats(heapStats);
+        return;
+      }
+
+      MemoryStats stats = memoryStats();
+      bool over = (heapSoftLimit && stats.heap.usedBytes>heapSoftLimit) ||
+                  (gpuSoftLimit  && stats.totalGPUBytes()>gpuSoftLimit);
+
+      if(over && !overMemoryLimit)
+      {
+        tpWarning() << "Memory soft limit exceeded, heap: " << stats.heap.usedBytes << " gpu: " << stats.totalGPUBytes();
+        q->memoryLimitCallbacks(stats);
+      }
+
+      overMemoryLimit = over;
+    }
+#endif
+  }
+
   //################################################################################################
   void printMutexStats()
   {
@@ -85,8 +526,18 @@ struct MapManager::Private
   {
     Private* d = reinterpret_cast<Private*>(opaque);
 
+    TraceScope trace("mainLoop");
     d->animate();
     d->processEvents();
+    d->processBatchRender();
+    if(d->coroutineScheduler.suspended())
+    {
+      TraceScope trace("coroutines");
+      d->coroutineScheduler.resume();
+    }
+    if(!d->mapPool.empty())
+      d->trimMapPool(tp_utils::currentTimeMS());
+    d->checkMemory();
     d->printMutexStats();
   }
 
@@ -98,6 +549,7 @@ struct MapManager::Private
     Private* d = reinterpret_cast<Private*>(opaque);
 
     d->animate();
+    d->assetCache.trim();
   }
 
   //################################################################################################
@@ -146,14 +598,21 @@ void MapManager::exec()
 //##################################################################################################
 void* MapManager::createMap(const char* canvasID)
 {
-  if(emscripten_set_resize_callback(canvasID,
-                                    d,
-                                    EM_TRUE,
-                                    Private::resizeCallback) != EMSCRIPTEN_RESULT_SUCCESS)
-    tpWarning() << "Failed to install resize callback.";
+  tp_maps_emcc::Map* map = d->takePooledMap(canvasID);
+  if(!map)
+  {
+    // Make room for the new context so that the browser does not drop one of the live ones.
+    d->trimMapPool(tp_utils::currentTimeMS(), 1);
+    map = new tp_maps_emcc::Map(canvasID, false, false);
+  }
 
-  tp_maps_emcc::MapDetails* details = d->createMapDetails(new tp_maps_emcc::Map(canvasID, false));
+  tp_maps_emcc::MapDetails* details = d->createMapDetails(map);
   d->maps.push_back(details);
+
+  int slot = d->inputRouter.add(details->map);
+  d->slots[details] = slot;
+  tp_maps_emcc_bind_canvas(canvasID, &d->inputRouter, slot);
+
   return details;
 }
 
@@ -164,7 +623,170 @@ void MapManager::destroyMap(void* handle)
   {
     MapDetails* details = (MapDetails*)handle;
     tpRemoveOne(d->maps, details);
+
+    if(auto i=d->slots.find(details); i!=d->slots.end())
+    {
+      tp_maps_emcc_unbind_canvas(&d->inputRouter, i->second);
+      d->inputRouter.remove(i->second);
+      d->slots.erase(i);
+    }
+
+    Map* map = details->map;
+    bool recycleMap = d->mapPoolSize>0 && !map->hasError();
+    details->m_recycleMap = recycleMap;
     delete details;
+
+    if(recycleMap)
+    {
+      map->recycle();
+      d->mapPool.push_back({map, tp_utils::currentTimeMS()});
+      d->trimMapPool(tp_utils::currentTimeMS());
+    }
+  }
+}
+
+//##################################################################################################
+AssetCache& MapManager::assetCache()
+{
+  return d->assetCache;
+}
+
+//##################################################################################################
+CoroutineScheduler& MapManager::coroutineScheduler()
+{
+  return d->coroutineScheduler;
+}
+
+//##################################################################################################
+size_t MapManager::animateTicks() const
+{
+  return d->animateTicks;
+}
+
+//##################################################################################################
+MemoryStats MapManager::memoryStats()
+{
+  return d->memoryStats();
+}
+
+//##################################################################################################
+void MapManager::setMemorySoftLimits(size_t heapBytes, size_t gpuBytes)
+{
+  d->heapSoftLimit = heapBytes;
+  d->gpuSoftLimit = gpuBytes;
+  d->overMemoryLimit = false;
+  d->nextMemoryCheck = 0;
+}
+
+//##################################################################################################
+void MapManager::setMapPoolSize(size_t mapPoolSize, bool replaceCanvas)
+{
+  d->mapPoolSize = mapPoolSize;
+  d->mapPoolReplaceCanvas = replaceCanvas;
+  d->trimMapPool(tp_utils::currentTimeMS());
+}
+
+//##################################################################################################
+void MapManager::setMapPoolIdleTimeout(int64_t mapPoolIdleTimeoutMS)
+{
+  d->mapPoolIdleTimeoutMS = mapPoolIdleTimeoutMS;
+}
+
+//##################################################################################################
+size_t MapManager::enqueueBatchRender(const BatchRenderJob& job)
+{
+  return d->batchRenderQueue()->enqueue(job);
+}
+
+//##################################################################################################
+size_t MapManager::batchRenderPending() const
+{
+  return d->batchQueue?d->batchQueue->pending():0;
+}
+
+//##################################################################################################
+void MapManager::setBatchRenderBudget(double batchRenderBudgetMS)
+{
+  d->batchRenderBudgetMS = batchRenderBudgetMS;
+}
+
+//##################################################################################################
+double MapManager::batchThumbnailsPerSecond() const
+{
+  return d->batchQueue?d->batchQueue->thumbnailsPerSecond():0.0;
+}
+
+}
+
+//##################################################################################################
+extern "C"
+{
+
+//##################################################################################################
+EMSCRIPTEN_KEEPALIVE void tp_maps_emcc_dispatch_mouse(void* router,
+                                                      int slot,
+                                                      int type,
+                                                      int button,
+                                                      double x,
+                                                      double y,
+                                                      int movementX,
+                                                      int movementY,
+                                                      int modifiers,
+                                                      double eventTimeMS)
+{
+  using namespace tp_maps_emcc;
+  if(Map* map = static_cast<InputRouter_lt*>(router)->map(slot); map)
+  {
+    MouseInput input;
+    input.type = MouseInputType(type);
+    input.button = button;
+    input.targetX = x;
+    input.targetY = y;
+    input.movementX = movementX;
+    input.movementY = movementY;
+    input.modifiers = InputRouter_lt::modifiers(modifiers);
+    input.eventTimeMS = eventTimeMS;
+    map->mouseInput(input);
+  }
+}
+
+//##################################################################################################
+EMSCRIPTEN_KEEPALIVE void tp_maps_emcc_dispatch_wheel(void* router, int slot, double deltaY, double eventTimeMS)
+{
+  using namespace tp_maps_emcc;
+  if(Map* map = static_cast<InputRouter_lt*>(router)->map(slot); map)
+  {
+    WheelInput input;
+    input.deltaY = deltaY;
+    input.eventTimeMS = eventTimeMS;
+    map->wheelInput(input);
+  }
+}
+
+//##################################################################################################
+EMSCRIPTEN_KEEPALIVE void tp_maps_emcc_dispatch_touch(void* router,
+                                                      int slot,
+                                                      int type,
+                                                      int numTouches,
+                                                      double x0,
+                                                      double y0,
+                                                      double x1,
+                                                      double y1,
+                                                      int modifiers,
+                                                      double eventTimeMS)
+{
+  using namespace tp_maps_emcc;
+  if(Map* map = static_cast<InputRouter_lt*>(router)->map(slot); map)
+  {
+    TouchInput input;
+    input.type = TouchInputType(type);
+    input.numTouches = numTouches;
+    input.touches[0] = {x0, y0};
+    input.touches[1] = {x1, y1};
+    input.timeMS = tp_utils::currentTimeMS();
+    input.modifiers = InputRouter_lt::modifiers(modifiers);
+    input.eventTimeMS = eventTimeMS;
+    map->touchInput(input);
   }
 }
 
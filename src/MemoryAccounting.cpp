@@ -0,0 +1,288 @@
+#include "tp_maps_emcc/MemoryAccounting.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <emscripten.h>
+#include <emscripten/heap.h>
+
+#include <malloc.h>
+#include <cstdint>
+
+#ifndef TP_MAPS_EMCC_NO_MEMORY_ACCOUNTING
+//##################################################################################################
+EM_JS(void, tp_maps_emcc_install_gpu_memory_accounting, (int handle), {
+  var context = GL.getContext(handle);
+  if(!context || !context.GLctx || context.GLctx.__tpMapsEmccMemory)
+    return;
+
+  var gl = context.GLctx;
+  var memory = {buffers: 0, textures: 0, renderbuffers: 0};
+  gl.__tpMapsEmccMemory = memory;
+
+  // Bindings are read from the GL state cache's shadow, or tracked here in the same shape if it has
+  // been compiled out, rather than queried because getParameter is slow.
+  var cache = gl.__tpMapsEmccStateCache;
+  var bound = cache ? cache.state : {buffers: {}, textures: [], activeTexture: 0x84C0, renderbuffer: null};
+
+  // Bytes per texel of sized internal formats.
+  var sizedFormats = {
+    0x8229: 1, 0x822B: 2, 0x8051: 3, 0x8058: 4, 0x8C41: 3, 0x8C43: 4, 0x8D62: 2, 0x8056: 2,
+    0x8057: 2, 0x8059: 4, 0x8C3A: 4, 0x822D: 2, 0x822F: 4, 0x881B: 6, 0x881A: 8, 0x822E: 4,
+    0x8230: 8, 0x8815: 12, 0x8814: 16, 0x81A5: 2, 0x81A6: 4, 0x8CAC: 4, 0x88F0: 4, 0x8CAD: 8,
+    0x8D48: 1
+  };
+
+  // Components of unsized formats.
+  var formatComponents = {
+    0x1906: 1, 0x1909: 1, 0x190A: 2, 0x1907: 3, 0x1908: 4, 0x1902: 1, 0x84F9: 1, 0x1903: 1,
+    0x8227: 2
+  };
+
+  var typeBytes = {0x1401: 1, 0x1400: 1, 0x1403: 2, 0x1402: 2, 0x1405: 4, 0x1404: 4, 0x1406: 4, 0x140B: 2, 0x8D61: 2};
+
+  // Packed types give the size of the whole texel.
+  var packedTypes = {0x8033: 2, 0x8034: 2, 0x8363: 2, 0x84FA: 4, 0x8368: 4, 0x8C3B: 4, 0x8C3E: 4, 0x8DAD: 8};
+
+  function bytesPerTexel(internalFormat, format, type) {
+    if(sizedFormats[internalFormat])
+      return sizedFormats[internalFormat];
+    if(packedTypes[type])
+      return packedTypes[type];
+    return (formatComponents[format] || formatComponents[internalFormat] || 4) * (typeBytes[type] || 1);
+  }
+
+  // Cube map faces are bound through TEXTURE_CUBE_MAP.
+  function textureBinding(target) {
+    return (target >= 0x8515 && target <= 0x851A) ? 0x8513 : target;
+  }
+
+  function boundTexture(target) {
+    var unit = bound.textures[bound.activeTexture - 0x84C0];
+    return unit ? unit[textureBinding(target)] : null;
+  }
+
+  // Each texture level or cube face is sized separately so that respecifying it replaces the old size.
+  function setTextureImage(target, level, bytes) {
+    var texture = boundTexture(target);
+    if(!texture)
+      return;
+    texture.__tpMapsEmccImages = texture.__tpMapsEmccImages || {};
+    var key = target + ":" + level;
+    var change = bytes - (texture.__tpMapsEmccImages[key] || 0);
+    texture.__tpMapsEmccImages[key] = bytes;
+    texture.__tpMapsEmccBytes = (texture.__tpMapsEmccBytes || 0) + change;
+    memory.textures += change;
+  }
+
+  function setTextureStorage(target, levels, width, height, depth, bpp) {
+    var texture = boundTexture(target);
+    if(!texture)
+      return;
+    var bytes = 0;
+    for(var i=0; i<levels; i++) {
+      bytes += Math.max(1, width>>i) * Math.max(1, height>>i) * (target === 0x8C1A ? depth : Math.max(1, depth>>i)) * bpp;
+    }
+    if(target === 0x8513)
+      bytes *= 6;
+    memory.textures += bytes;
+    texture.__tpMapsEmccImages = {};
+    texture.__tpMapsEmccBytes = (texture.__tpMapsEmccBytes || 0) + bytes;
+  }
+
+  function wrap(name, before) {
+    var original = gl[name];
+    if(!original)
+      return;
+    gl[name] = function() {
+      before.apply(null, arguments);
+      return original.apply(gl, arguments);
+    };
+  }
+
+  if(!cache) {
+    wrap("bindBuffer", function(target, buffer) { bound.buffers[target] = buffer; });
+
+    // Indexed binds also replace the generic binding for the target.
+    wrap("bindBufferBase", function(target, index, buffer) { bound.buffers[target] = buffer; });
+    wrap("bindBufferRange", function(target, index, buffer) { bound.buffers[target] = buffer; });
+
+    wrap("activeTexture", function(unit) { bound.activeTexture = unit; });
+
+    wrap("bindTexture", function(target, texture) {
+      var i = bound.activeTexture - 0x84C0;
+      (bound.textures[i] || (bound.textures[i] = {}))[target] = texture;
+    });
+
+    wrap("bindRenderbuffer", function(target, renderbuffer) { bound.renderbuffer = renderbuffer; });
+
+    // The element array binding belongs to the vertex array.
+    wrap("bindVertexArray", function() { bound.buffers[0x8893] = undefined; });
+  }
+
+  wrap("bufferData", function(target, data, usage, srcOffset, length) {
+    var buffer = bound.buffers[target];
+    if(buffer === undefined && target === 0x8893)
+      buffer = gl.getParameter(0x8895);
+    if(!buffer)
+      return;
+
+    var bytes;
+    if(typeof data === "number")
+      bytes = data;
+    else if(!data)
+      bytes = 0;
+    else {
+      var elementBytes = data.BYTES_PER_ELEMENT || 1;
+      if(length)
+        bytes = length * elementBytes;
+      else
+        bytes = data.byteLength - (srcOffset || 0) * elementBytes;
+    }
+
+    memory.buffers += bytes - (buffer.__tpMapsEmccBytes || 0);
+    buffer.__tpMapsEmccBytes = bytes;
+  });
+
+  wrap("texImage2D", function(target, level, internalFormat) {
+    var width, height, format, type;
+    if(arguments.length >= 8) {
+      width = arguments[3];
+      height = arguments[4];
+      format = arguments[6];
+      type = arguments[7];
+    }
+    else {
+      var source = arguments[5];
+      width = source ? (source.videoWidth || source.displayWidth || source.width || 0) : 0;
+      height = source ? (source.videoHeight || source.displayHeight || source.height || 0) : 0;
+      format = arguments[3];
+      type = arguments[4];
+    }
+    setTextureImage(target, level, width * height * bytesPerTexel(internalFormat, format, type));
+  });
+
+  wrap("texImage3D", function(target, level, internalFormat, width, height, depth, border, format, type) {
+    setTextureImage(target, level, width * height * depth * bytesPerTexel(internalFormat, format, type));
+  });
+
+  wrap("compressedTexImage2D", function(target, level, internalFormat, width, height, border, data, srcOffset, length) {
+    var bytes = length || (data ? data.byteLength - (srcOffset || 0) : 0);
+    setTextureImage(target, level, bytes);
+  });
+
+  wrap("texStorage2D", function(target, levels, internalFormat, width, height) {
+    setTextureStorage(target, levels, width, height, 1, bytesPerTexel(internalFormat, 0, 0));
+  });
+
+  wrap("texStorage3D", function(target, levels, internalFormat, width, height, depth) {
+    setTextureStorage(target, levels, width, height, depth, bytesPerTexel(internalFormat, 0, 0));
+  });
+
+  function setRenderbufferStorage(samples, internalFormat, width, height) {
+    var renderbuffer = bound.renderbuffer;
+    if(!renderbuffer)
+      return;
+    var bytes = width * height * Math.max(1, samples) * bytesPerTexel(internalFormat, 0, 0);
+    memory.renderbuffers += bytes - (renderbuffer.__tpMapsEmccBytes || 0);
+    renderbuffer.__tpMapsEmccBytes = bytes;
+  }
+
+  wrap("renderbufferStorage", function(target, internalFormat, width, height) {
+    setRenderbufferStorage(1, internalFormat, width, height);
+  });
+
+  wrap("renderbufferStorageMultisample", function(target, samples, internalFormat, width, height) {
+    setRenderbufferStorage(samples, internalFormat, width, height);
+  });
+
+  wrap("deleteBuffer", function(buffer) {
+    if(buffer && buffer.__tpMapsEmccBytes) {
+      memory.buffers -= buffer.__tpMapsEmccBytes;
+      buffer.__tpMapsEmccBytes = 0;
+    }
+  });
+
+  wrap("deleteTexture", function(texture) {
+    if(texture && texture.__tpMapsEmccBytes) {
+      memory.textures -= texture.__tpMapsEmccBytes;
+      texture.__tpMapsEmccBytes = 0;
+      texture.__tpMapsEmccImages = {};
+    }
+  });
+
+  wrap("deleteRenderbuffer", function(renderbuffer) {
+    if(renderbuffer && renderbuffer.__tpMapsEmccBytes) {
+      memory.renderbuffers -= renderbuffer.__tpMapsEmccBytes;
+      renderbuffer.__tpMapsEmccBytes = 0;
+    }
+  });
+});
+
+//##################################################################################################
+EM_JS(void, tp_maps_emcc_gpu_memory_stats, (int handle, double* out), {
+  var context = GL.getContext(handle);
+  var gl = context && context.GLctx;
+  var memory = gl && gl.__tpMapsEmccMemory;
+  HEAPF64[out>>3] = memory ? memory.buffers : 0;
+  HEAPF64[(out>>3)+1] = memory ? memory.textures : 0;
+  HEAPF64[(out>>3)+2] = memory ? memory.renderbuffers : 0;
+
+  var drawingBuffer = 0;
+  if(gl) {
+    var attributes = gl.getContextAttributes() || {};
+    var bytesPerPixel = 4 + ((attributes.depth || attributes.stencil) ? 4 : 0);
+    drawingBuffer = gl.drawingBufferWidth * gl.drawingBufferHeight * bytesPerPixel;
+  }
+  HEAPF64[(out>>3)+3] = drawingBuffer;
+});
+#endif
+
+namespace tp_maps_emcc
+{
+
+//##################################################################################################
+void installGPUMemoryAccounting(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+#ifndef TP_MAPS_EMCC_NO_MEMORY_ACCOUNTING
+  tp_maps_emcc_install_gpu_memory_accounting(int(context));
+#else
+  TP_UNUSED(context);
+#endif
+}
+
+//##################################################################################################
+void gpuMemoryStats(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, GPUMemoryStats& stats)
+{
+#ifndef TP_MAPS_EMCC_NO_MEMORY_ACCOUNTING
+  double bytes[4]{0.0, 0.0, 0.0, 0.0};
+  tp_maps_emcc_gpu_memory_stats(int(context), bytes);
+  stats.bufferBytes        = size_t(bytes[0]);
+  stats.textureBytes       = size_t(bytes[1]);
+  stats.renderbufferBytes  = size_t(bytes[2]);
+  stats.drawingBufferBytes = size_t(bytes[3]);
+#else
+  TP_UNUSED(context);
+  stats = GPUMemoryStats();
+#endif
+}
+
+//##################################################################################################
+void sampleHeapStats(HeapStats& stats)
+{
+  size_t heapBytes = emscripten_get_heap_size();
+  if(stats.heapBytes != 0 && heapBytes > stats.heapBytes)
+    stats.samplesWithHeapGrowth++;
+  stats.heapBytes = heapBytes;
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  // mallinfo() is deprecated in glibc 2.33 and its int fields overflow past 2GB.
+  struct mallinfo2 info = mallinfo2();
+#else
+  struct mallinfo info = mallinfo();
+#endif
+  stats.usedBytes = size_t(info.uordblks);
+  if(stats.usedBytes > stats.peakSampledUsedBytes)
+    stats.peakSampledUsedBytes = stats.usedBytes;
+}
+
+}
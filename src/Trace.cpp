@@ -0,0 +1,197 @@
+#include "tp_maps_emcc/Trace.h"
+
+#include <emscripten.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+namespace tp_maps_emcc
+{
+
+bool traceEnabledFlag{false};
+
+namespace
+{
+//##################################################################################################
+struct TraceEvent_lt
+{
+  const char* name{nullptr};
+  char detail[32]{};
+  int64_t index{-1};
+  double begin{0.0};
+  double end{0.0};
+};
+
+//##################################################################################################
+struct TraceBuffer_lt
+{
+  std::vector<TraceEvent_lt> events;
+  size_t next{0};
+  size_t count{0};
+  bool emitPerformanceMeasures{false};
+};
+
+//##################################################################################################
+TraceBuffer_lt& traceBuffer()
+{
+  static TraceBuffer_lt buffer;
+  return buffer;
+}
+
+//##################################################################################################
+//! Remove the marks and measures emitted by TraceScope, leaving any others on the page alone.
+void clearPerformanceMeasures()
+{
+  EM_ASM({
+           var names = Module.tpMapsEmccMeasureNames;
+           if(names && typeof performance !== "undefined" && performance.clearMeasures)
+             names.forEach(function(name) {
+               performance.clearMeasures(name);
+               performance.clearMarks(name + " start");
+               performance.clearMarks(name + " end");
+             });
+           Module.tpMapsEmccMeasureNames = new Set();
+         });
+}
+
+//##################################################################################################
+void appendEscaped(std::string& result, const char* text)
+{
+  for(const char* c=text; *c; c++)
+  {
+    if(*c=='"' || *c=='\\')
+      result.push_back('\\');
+    if(uint8_t(*c)>=0x20)
+      result.push_back(*c);
+  }
+}
+}
+
+//##################################################################################################
+void setTraceEnabled(bool enabled, size_t capacity, bool emitPerformanceMeasures)
+{
+  TraceBuffer_lt& buffer = traceBuffer();
+  if(enabled && buffer.events.size() != capacity)
+  {
+    buffer.events.clear();
+    buffer.events.resize(capacity);
+    buffer.next = 0;
+    buffer.count = 0;
+  }
+
+  if(!enabled)
+    clearPerformanceMeasures();
+
+  buffer.emitPerformanceMeasures = emitPerformanceMeasures;
+  traceEnabledFlag = enabled && capacity>0;
+}
+
+//##################################################################################################
+void clearTrace()
+{
+  TraceBuffer_lt& buffer = traceBuffer();
+  buffer.next = 0;
+  buffer.count = 0;
+  clearPerformanceMeasures();
+}
+
+//##################################################################################################
+std::string traceToChromeJSON()
+{
+  TraceBuffer_lt& buffer = traceBuffer();
+
+  std::string result;
+  result.reserve(buffer.count*96 + 32);
+  result += "{\"traceEvents\":[";
+
+  size_t first = (buffer.next + buffer.events.size() - buffer.count) % std::max(size_t(1), buffer.events.size());
+  char number[96];
+  for(size_t i=0; i<buffer.count; i++)
+  {
+    const TraceEvent_lt& event = buffer.events[(first+i) % buffer.events.size()];
+
+    if(i)
+      result.push_back(',');
+
+    result += "{\"name\":\"";
+    appendEscaped(result, event.name);
+    std::snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                  event.begin*1000.0, (event.end-event.begin)*1000.0);
+    result += number;
+
+    bool comma=false;
+    if(event.detail[0])
+    {
+      result += "\"detail\":\"";
+      appendEscaped(result, event.detail);
+      result.push_back('"');
+      comma = true;
+    }
+
+    if(event.index>=0)
+    {
+      std::snprintf(number, sizeof(number), "%s\"index\":%lld", comma?",":"", (long long)event.index);
+      result += number;
+    }
+
+    result += "}}";
+  }
+
+  result += "],\"displayTimeUnit\":\"ms\"}";
+  return result;
+}
+
+//##################################################################################################
+void TraceScope::begin(const char* detail, int64_t index)
+{
+  m_detail = detail;
+  m_index = index;
+  m_begin = emscripten_get_now();
+}
+
+//##################################################################################################
+void TraceScope::end()
+{
+  TraceBuffer_lt& buffer = traceBuffer();
+  if(buffer.events.empty())
+    return;
+
+  TraceEvent_lt& event = buffer.events[buffer.next];
+  buffer.next = (buffer.next+1) % buffer.events.size();
+  buffer.count = std::min(buffer.count+1, buffer.events.size());
+
+  event.name = m_name;
+  event.index = m_index;
+  event.begin = m_begin;
+  event.end = emscripten_get_now();
+
+  if(m_detail)
+  {
+    std::strncpy(event.detail, m_detail, sizeof(event.detail)-1);
+    event.detail[sizeof(event.detail)-1] = 0;
+  }
+  else
+    event.detail[0] = 0;
+
+  if(buffer.emitPerformanceMeasures)
+  {
+    EM_ASM({
+             var name = UTF8ToString($0);
+             if($1)
+               name += " " + UTF8ToString($1);
+             if($2>=0)
+               name += " #" + $2;
+             if(typeof performance !== "undefined" && performance.measure)
+             {
+               performance.mark(name + " start", {startTime: $3});
+               performance.mark(name + " end", {startTime: $4});
+               performance.measure(name, name + " start", name + " end");
+               (Module.tpMapsEmccMeasureNames = Module.tpMapsEmccMeasureNames || new Set()).add(name);
+             }
+           }, event.name, event.detail[0]?event.detail:nullptr, int(event.index), event.begin, event.end);
+  }
+}
+
+}
@@ -0,0 +1,3 @@
+DEPENDENCIES += tp_maps
+INCLUDEPATHS += tp_maps_emcc/inc/
+INCLUDEPATHS += tp_maps_emcc/tests/src/
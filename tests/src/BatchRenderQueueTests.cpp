@@ -0,0 +1,170 @@
+#include "Test.h"
+
+#include "tp_maps_emcc/BatchRenderQueue.h"
+
+#include <stdexcept>
+#include <cmath>
+
+using namespace tp_maps_emcc;
+
+namespace tp_maps_emcc_tests
+{
+
+namespace
+{
+//##################################################################################################
+//! A render function that fills the pixels without a map, advancing a fake clock by costMS.
+struct Renderer_lt
+{
+  double nowMS{1000.0};
+  double costMS{0.0};
+  size_t calls{0};
+
+  //################################################################################################
+  BatchRenderQueue::RenderFunction function()
+  {
+    return [this](tp_maps::Map*, int width, int height, std::vector<uint8_t>& pixels)
+    {
+      calls++;
+      nowMS += costMS;
+      pixels.assign(size_t(width)*size_t(height)*4, 255);
+      return true;
+    };
+  }
+
+  //################################################################################################
+  BatchRenderQueue::ClockFunction clock()
+  {
+    return [this]{return nowMS;};
+  }
+};
+
+//##################################################################################################
+BatchRenderJob job(std::vector<BatchRenderResult>& results)
+{
+  BatchRenderJob job;
+  job.width = 4;
+  job.height = 2;
+  job.done = [&results](BatchRenderResult& result){results.push_back(std::move(result));};
+  return job;
+}
+
+//##################################################################################################
+void order()
+{
+  Renderer_lt renderer;
+  BatchRenderQueue queue(nullptr, renderer.function());
+  std::vector<BatchRenderResult> results;
+
+  size_t a = queue.enqueue(job(results));
+  size_t b = queue.enqueue(job(results));
+  size_t c = queue.enqueue(job(results));
+  TP_CHECK(a<b && b<c);
+  TP_CHECK(queue.pending() == 3);
+
+  TP_CHECK(queue.process(1000.0) == 3);
+  TP_CHECK(queue.pending() == 0);
+  TP_CHECK(queue.rendered() == 3);
+  TP_CHECK(results.size() == 3);
+  TP_CHECK(results.at(0).jobID == a && results.at(1).jobID == b && results.at(2).jobID == c);
+  TP_CHECK(results.at(0).success);
+  TP_CHECK(results.at(0).pixels.size() == 4*2*4);
+}
+
+//##################################################################################################
+void budget()
+{
+  Renderer_lt renderer;
+  renderer.costMS = 20.0;
+  BatchRenderQueue queue(nullptr, renderer.function());
+  queue.setClock(renderer.clock());
+  std::vector<BatchRenderResult> results;
+
+  for(int i=0; i<5; i++)
+    queue.enqueue(job(results));
+
+  // A budget shorter than a job still renders one.
+  TP_CHECK(queue.process(0.0) == 1);
+  TP_CHECK(queue.pending() == 4);
+
+  // Jobs are started until the budget has been used, the third starts at 40ms of 50ms.
+  TP_CHECK(queue.process(50.0) == 3);
+  TP_CHECK(queue.pending() == 1);
+
+  TP_CHECK(queue.process(1000.0) == 1);
+  TP_CHECK(queue.pending() == 0);
+  TP_CHECK(results.size() == 5);
+  TP_CHECK(std::abs(queue.thumbnailsPerSecond()-50.0)<1e-6);
+
+  // An empty queue does nothing.
+  TP_CHECK(queue.process(1000.0) == 0);
+}
+
+//##################################################################################################
+void exceptions()
+{
+  Renderer_lt renderer;
+  BatchRenderQueue queue(nullptr, renderer.function());
+  std::vector<BatchRenderResult> results;
+
+  BatchRenderJob throwing = job(results);
+  throwing.prepare = [](tp_maps::Map*){throw std::runtime_error("prepare");};
+  size_t a = queue.enqueue(throwing);
+  size_t b = queue.enqueue(job(results));
+
+  TP_CHECK(queue.process(1000.0) == 2);
+  TP_CHECK(results.size() == 2);
+  TP_CHECK(results.at(0).jobID == a && !results.at(0).success);
+  TP_CHECK(results.at(1).jobID == b &&  results.at(1).success);
+  TP_CHECK(renderer.calls == 1);
+}
+
+//##################################################################################################
+void ready()
+{
+  Renderer_lt renderer;
+  int polls=0;
+  BatchRenderQueue queue(nullptr, renderer.function(), [&](tp_maps::Map*){return ++polls>=3;});
+  std::vector<BatchRenderResult> results;
+
+  int prepared=0;
+  BatchRenderJob waiting = job(results);
+  waiting.prepare = [&](tp_maps::Map*){prepared++;};
+  queue.enqueue(waiting);
+  queue.enqueue(job(results));
+
+  // The first job holds the queue until it is ready and is only prepared once.
+  TP_CHECK(queue.process(1000.0) == 0);
+  TP_CHECK(queue.process(1000.0) == 0);
+  TP_CHECK(renderer.calls == 0);
+  TP_CHECK(queue.process(1000.0) == 2);
+  TP_CHECK(prepared == 1);
+  TP_CHECK(results.size() == 2);
+  TP_CHECK(!results.at(0).timedOut);
+
+  // A job's own ready function takes precedence over the queue's, it is rendered once it times out.
+  queue.setClock(renderer.clock());
+  BatchRenderJob never = job(results);
+  never.ready = [](tp_maps::Map*){return false;};
+  never.timeoutMS = 100.0;
+  queue.enqueue(never);
+  TP_CHECK(queue.process(1000.0) == 0);
+  renderer.nowMS += 99.0;
+  TP_CHECK(queue.process(1000.0) == 0);
+  renderer.nowMS += 1.0;
+  TP_CHECK(queue.process(1000.0) == 1);
+  TP_CHECK(results.size() == 3);
+  TP_CHECK(results.at(2).timedOut && results.at(2).success);
+}
+}
+
+//##################################################################################################
+void batchRenderQueueTests()
+{
+  order();
+  budget();
+  exceptions();
+  ready();
+}
+
+}
@@ -0,0 +1,166 @@
+#include "Test.h"
+
+#include "tp_maps_emcc/Coroutines.h"
+
+#include <memory>
+#include <vector>
+
+using namespace tp_maps_emcc;
+
+namespace tp_maps_emcc_tests
+{
+
+namespace
+{
+//##################################################################################################
+//! A waiter driven directly, without a coroutine, that records the order it is woken in.
+struct Waiter_lt : CoroutineWaiter
+{
+  bool isReady{false};
+  int id{0};
+  std::vector<int>* woken{nullptr};
+
+  //################################################################################################
+  Waiter_lt(int id_, std::vector<int>& woken_):
+    id(id_),
+    woken(&woken_)
+  {
+    poll = [](CoroutineWaiter* w){return static_cast<Waiter_lt*>(w)->isReady;};
+    wake = [](CoroutineWaiter* w){static_cast<Waiter_lt*>(w)->woken->push_back(static_cast<Waiter_lt*>(w)->id);};
+  }
+};
+
+//##################################################################################################
+void resumeOrder()
+{
+  CoroutineScheduler scheduler;
+  std::vector<int> woken;
+
+  Waiter_lt a(1, woken);
+  Waiter_lt b(2, woken);
+  Waiter_lt c(3, woken);
+  scheduler.suspend(&a);
+  scheduler.suspend(&b);
+  scheduler.suspend(&c);
+  TP_CHECK(scheduler.suspended() == 3);
+
+  // Ready waiters are woken in the order they suspended, the rest stay suspended.
+  a.isReady = true;
+  c.isReady = true;
+  scheduler.resume();
+  TP_CHECK((woken == std::vector<int>{1, 3}));
+  TP_CHECK(scheduler.suspended() == 1);
+
+  b.isReady = true;
+  scheduler.resume();
+  TP_CHECK((woken == std::vector<int>{1, 3, 2}));
+  TP_CHECK(scheduler.suspended() == 0);
+}
+
+#ifdef TP_MAPS_EMCC_COROUTINES
+//##################################################################################################
+//! Sets a flag when the coroutine frame holding it is destroyed.
+struct Guard_lt
+{
+  bool* destroyed;
+  ~Guard_lt(){*destroyed = true;}
+};
+
+//##################################################################################################
+Task waitUntil(CoroutineScheduler& scheduler, const bool& go, std::vector<int>& steps, int id)
+{
+  steps.push_back(id);
+  co_await until(scheduler, [&]{return go;});
+  steps.push_back(id+10);
+}
+
+//##################################################################################################
+Task waitForever(CoroutineScheduler& scheduler, bool& destroyed)
+{
+  Guard_lt guard{&destroyed};
+  co_await until(scheduler, []{return false;});
+}
+
+//##################################################################################################
+Task delayed(CoroutineScheduler& scheduler, int64_t ms, bool& finished)
+{
+  co_await delay(scheduler, ms);
+  finished = true;
+}
+
+//##################################################################################################
+void untilPredicate()
+{
+  CoroutineScheduler scheduler;
+  std::vector<int> steps;
+  bool goA=false;
+  bool goB=false;
+
+  waitUntil(scheduler, goA, steps, 1);
+  waitUntil(scheduler, goB, steps, 2);
+  TP_CHECK((steps == std::vector<int>{1, 2}));
+  TP_CHECK(scheduler.suspended() == 2);
+
+  // Nothing resumes until its predicate is true.
+  scheduler.resume();
+  TP_CHECK(steps.size() == 2);
+
+  goB = true;
+  scheduler.resume();
+  TP_CHECK((steps == std::vector<int>{1, 2, 12}));
+  TP_CHECK(scheduler.suspended() == 1);
+
+  goA = true;
+  scheduler.resume();
+  TP_CHECK((steps == std::vector<int>{1, 2, 12, 11}));
+  TP_CHECK(scheduler.suspended() == 0);
+}
+
+//##################################################################################################
+void destroySuspended()
+{
+  bool destroyed=false;
+  {
+    CoroutineScheduler scheduler;
+    waitForever(scheduler, destroyed);
+    scheduler.resume();
+    TP_CHECK(scheduler.suspended() == 1);
+    TP_CHECK(!destroyed);
+  }
+
+  // Destroying the scheduler destroys the frame and the locals in it.
+  TP_CHECK(destroyed);
+}
+
+//##################################################################################################
+void delays()
+{
+  CoroutineScheduler scheduler;
+
+  // A delay that has already passed does not suspend.
+  bool now=false;
+  delayed(scheduler, 0, now);
+  TP_CHECK(now);
+  TP_CHECK(scheduler.suspended() == 0);
+
+  bool later=false;
+  delayed(scheduler, 60*60*1000, later);
+  scheduler.resume();
+  TP_CHECK(!later);
+  TP_CHECK(scheduler.suspended() == 1);
+}
+#endif
+}
+
+//##################################################################################################
+void coroutineTests()
+{
+  resumeOrder();
+#ifdef TP_MAPS_EMCC_COROUTINES
+  untilPredicate();
+  destroySuspended();
+  delays();
+#endif
+}
+
+}
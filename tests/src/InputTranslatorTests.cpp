@@ -0,0 +1,217 @@
+#include "Test.h"
+
+#include "tp_maps_emcc/InputTranslator.h"
+
+#include <vector>
+
+using namespace tp_maps_emcc;
+
+namespace tp_maps_emcc_tests
+{
+
+namespace
+{
+//##################################################################################################
+struct Recorder_lt
+{
+  std::vector<tp_maps::MouseEvent> events;
+  InputTranslator translator{[&](const tp_maps::MouseEvent& e){events.push_back(e);}};
+
+  //################################################################################################
+  void touch(TouchInputType type, int64_t timeMS, double x, double y)
+  {
+    TouchInput input;
+    input.type = type;
+    input.numTouches = 1;
+    input.touches[0].targetX = x;
+    input.touches[0].targetY = y;
+    input.timeMS = timeMS;
+    translator.touchInput(input);
+  }
+
+  //################################################################################################
+  void touch2(TouchInputType type, int64_t timeMS, double ax, double ay, double bx, double by)
+  {
+    TouchInput input;
+    input.type = type;
+    input.numTouches = 2;
+    input.touches[0].targetX = ax;
+    input.touches[0].targetY = ay;
+    input.touches[1].targetX = bx;
+    input.touches[1].targetY = by;
+    input.timeMS = timeMS;
+    translator.touchInput(input);
+  }
+
+  //################################################################################################
+  bool is(size_t i, tp_maps::MouseEventType type, tp_maps::Button button = tp_maps::Button::LeftButton) const
+  {
+    return i<events.size() && events.at(i).type == type && events.at(i).button == button;
+  }
+};
+
+// The translator treats a press within 400ms of time zero as the second half of a double tap.
+constexpr int64_t t0=100000;
+
+//##################################################################################################
+void tap()
+{
+  Recorder_lt r;
+  r.touch(TouchInputType::Start, t0,    20, 30);
+  r.touch(TouchInputType::End,   t0+50, 21, 30);
+
+  TP_CHECK(r.events.size() == 2);
+  TP_CHECK(r.is(0, tp_maps::MouseEventType::Press));
+  TP_CHECK(r.is(1, tp_maps::MouseEventType::Release));
+  TP_CHECK(r.events.at(0).pos == glm::ivec2(20, 30));
+  TP_CHECK(r.events.at(1).pos == glm::ivec2(21, 30));
+}
+
+//##################################################################################################
+void slowTap()
+{
+  Recorder_lt r;
+  r.touch(TouchInputType::Start, t0,     20, 30);
+  r.touch(TouchInputType::End,   t0+500, 20, 30);
+
+  TP_CHECK(r.events.empty());
+}
+
+//##################################################################################################
+void doubleTap()
+{
+  Recorder_lt r;
+  r.touch(TouchInputType::Start, t0,     20, 30);
+  r.touch(TouchInputType::End,   t0+50,  20, 30);
+  r.touch(TouchInputType::Start, t0+200, 20, 30);
+  r.touch(TouchInputType::End,   t0+250, 20, 30);
+
+  TP_CHECK(r.events.size() == 3);
+  TP_CHECK(r.is(0, tp_maps::MouseEventType::Press));
+  TP_CHECK(r.is(1, tp_maps::MouseEventType::Release));
+  TP_CHECK(r.is(2, tp_maps::MouseEventType::DoubleClick));
+}
+
+//##################################################################################################
+void separateTaps()
+{
+  Recorder_lt r;
+  r.touch(TouchInputType::Start, t0,     20, 30);
+  r.touch(TouchInputType::End,   t0+50,  20, 30);
+  r.touch(TouchInputType::Start, t0+450, 20, 30);
+  r.touch(TouchInputType::End,   t0+500, 20, 30);
+
+  TP_CHECK(r.events.size() == 4);
+  TP_CHECK(r.is(2, tp_maps::MouseEventType::Press));
+  TP_CHECK(r.is(3, tp_maps::MouseEventType::Release));
+}
+
+//##################################################################################################
+void pan()
+{
+  Recorder_lt r;
+  r.touch(TouchInputType::Start, t0,    20, 30);
+
+  // Within 10 pixels nothing is emitted.
+  r.touch(TouchInputType::Move,  t0+10, 25, 33);
+  TP_CHECK(r.events.empty());
+
+  r.touch(TouchInputType::Move,  t0+20, 40, 30);
+  r.touch(TouchInputType::Move,  t0+30, 60, 30);
+  r.touch(TouchInputType::End,   t0+40, 70, 30);
+
+  TP_CHECK(r.events.size() == 3);
+  TP_CHECK(r.is(0, tp_maps::MouseEventType::Press));
+  TP_CHECK(r.events.at(0).pos == glm::ivec2(20, 30));
+  TP_CHECK(r.is(1, tp_maps::MouseEventType::Move, tp_maps::Button::NoButton));
+  TP_CHECK(r.events.at(1).pos == glm::ivec2(60, 30));
+  TP_CHECK(r.is(2, tp_maps::MouseEventType::Release));
+  TP_CHECK(r.events.at(2).pos == glm::ivec2(70, 30));
+}
+
+//##################################################################################################
+void pinch()
+{
+  Recorder_lt r;
+  r.touch2(TouchInputType::Start, t0,    0, 0, 100, 0);
+  TP_CHECK(r.events.empty());
+
+  // Spreading the fingers zooms in around the midpoint.
+  r.touch2(TouchInputType::Move,  t0+10, 0, 0, 120, 0);
+  TP_CHECK(r.events.size() == 1);
+  TP_CHECK(r.is(0, tp_maps::MouseEventType::Wheel, tp_maps::Button::NoButton));
+  TP_CHECK(r.events.at(0).delta > 0);
+  TP_CHECK(r.events.at(0).pos == glm::ivec2(50, 0));
+
+  // Changes too small to produce a delta are accumulated.
+  r.touch2(TouchInputType::Move,  t0+20, 0, 0, 120.1, 0);
+  TP_CHECK(r.events.size() == 1);
+
+  r.touch2(TouchInputType::Move,  t0+30, 0, 0, 90, 0);
+  TP_CHECK(r.events.size() == 2);
+  TP_CHECK(r.events.at(1).delta < 0);
+}
+
+//##################################################################################################
+void panToPinch()
+{
+  Recorder_lt r;
+  r.touch(TouchInputType::Start,  t0,    20, 30);
+  r.touch(TouchInputType::Move,   t0+10, 60, 30);
+  r.touch2(TouchInputType::Start, t0+20, 60, 30, 100, 30);
+
+  // The pan is released before zooming starts.
+  TP_CHECK(r.events.size() == 2);
+  TP_CHECK(r.is(1, tp_maps::MouseEventType::Release));
+}
+
+//##################################################################################################
+void pixelScale()
+{
+  Recorder_lt r;
+  r.translator.setPixelScale(2.0f);
+
+  MouseInput input;
+  input.type = MouseInputType::Down;
+  input.targetX = 10.0;
+  input.targetY = 20.0;
+  r.translator.mouseInput(input);
+
+  TP_CHECK(r.is(0, tp_maps::MouseEventType::Press));
+  TP_CHECK(r.events.at(0).pos == glm::ivec2(20, 40));
+}
+
+//##################################################################################################
+void mouseLeaveReleases()
+{
+  Recorder_lt r;
+
+  MouseInput input;
+  input.type = MouseInputType::Down;
+  input.button = 2;
+  r.translator.mouseInput(input);
+
+  input.type = MouseInputType::Leave;
+  r.translator.mouseInput(input);
+  r.translator.mouseInput(input);
+
+  TP_CHECK(r.events.size() == 2);
+  TP_CHECK(r.is(1, tp_maps::MouseEventType::Release, tp_maps::Button::RightButton));
+}
+}
+
+//##################################################################################################
+void inputTranslatorTests()
+{
+  tap();
+  slowTap();
+  doubleTap();
+  separateTaps();
+  pan();
+  pinch();
+  panToPinch();
+  pixelScale();
+  mouseLeaveReleases();
+}
+
+}
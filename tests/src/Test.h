@@ -0,0 +1,36 @@
+#ifndef tp_maps_emcc_tests_Test_h
+#define tp_maps_emcc_tests_Test_h
+
+#include <iostream>
+
+namespace tp_maps_emcc_tests
+{
+
+//##################################################################################################
+//! Number of failed checks, main returns non zero if any check failed.
+extern int failures;
+
+//##################################################################################################
+#define TP_CHECK(condition) \
+  do \
+  { \
+    if(!(condition)) \
+    { \
+      tp_maps_emcc_tests::failures++; \
+      std::cerr << __FILE__ << ":" << __LINE__ << " check failed: " #condition << std::endl; \
+    } \
+  } while(false)
+
+//##################################################################################################
+void inputTranslatorTests();
+
+//##################################################################################################
+void batchRenderQueueTests();
+
+//##################################################################################################
+//! The coroutine tests only check the scheduler unless built as C++20.
+void coroutineTests();
+
+}
+
+#endif
@@ -0,0 +1,24 @@
+#include "Test.h"
+
+namespace tp_maps_emcc_tests
+{
+int failures=0;
+}
+
+//##################################################################################################
+//! Native tests for the parts of tp_maps_emcc that do not depend on Emscripten.
+int main()
+{
+  tp_maps_emcc_tests::inputTranslatorTests();
+  tp_maps_emcc_tests::batchRenderQueueTests();
+  tp_maps_emcc_tests::coroutineTests();
+
+  if(tp_maps_emcc_tests::failures)
+  {
+    std::cerr << tp_maps_emcc_tests::failures << " checks failed." << std::endl;
+    return 1;
+  }
+
+  std::cout << "All tests passed." << std::endl;
+  return 0;
+}
@@ -0,0 +1,13 @@
+TARGET = tp_maps_emcc_tests
+TEMPLATE = app
+
+SOURCES += ../src/InputTranslator.cpp
+SOURCES += ../src/BatchRenderQueue.cpp
+SOURCES += ../src/Coroutines.cpp
+
+SOURCES += src/main.cpp
+HEADERS += src/Test.h
+
+SOURCES += src/InputTranslatorTests.cpp
+SOURCES += src/BatchRenderQueueTests.cpp
+SOURCES += src/CoroutineTests.cpp
@@ -9,5 +9,38 @@ HEADERS += inc/tp_maps_emcc/Map.h
 SOURCES += src/MapManager.cpp
 HEADERS += inc/tp_maps_emcc/MapManager.h
 
+SOURCES += src/FrameCapture.cpp
+HEADERS += inc/tp_maps_emcc/FrameCapture.h
+
+SOURCES += src/InputTranslator.cpp
+HEADERS += inc/tp_maps_emcc/InputTranslator.h
+
+SOURCES += src/Trace.cpp
+HEADERS += inc/tp_maps_emcc/Trace.h
+
+SOURCES += src/InputLatency.cpp
+HEADERS += inc/tp_maps_emcc/InputLatency.h
+
+SOURCES += src/BatchRenderQueue.cpp
+HEADERS += inc/tp_maps_emcc/BatchRenderQueue.h
+
+SOURCES += src/DataIngest.cpp
+HEADERS += inc/tp_maps_emcc/DataIngest.h
+
+SOURCES += src/GLStateCache.cpp
+HEADERS += inc/tp_maps_emcc/GLStateCache.h
+
+SOURCES += src/AssetCache.cpp
+HEADERS += inc/tp_maps_emcc/AssetCache.h
+
+SOURCES += src/Coroutines.cpp
+HEADERS += inc/tp_maps_emcc/Coroutines.h
+
+SOURCES += src/BuildVariant.cpp
+HEADERS += inc/tp_maps_emcc/BuildVariant.h
+
+SOURCES += src/MemoryAccounting.cpp
+HEADERS += inc/tp_maps_emcc/MemoryAccounting.h
+
 HEADERS += inc/tp_maps_emcc/Globals.h
 